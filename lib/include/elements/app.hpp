@@ -8,6 +8,7 @@
 
 #include <string>
 #include <infra/support.hpp>
+#include <elements/support/font.hpp>
 
 #if defined(ELEMENTS_HOST_UI_LIBRARY_GTK)
 using GtkApplication = struct _GtkApplication;
@@ -33,6 +34,11 @@ namespace cycfi::elements
       void                 run();
       void                 stop();
 
+      // Enumerate the fonts and load the theme's fonts on a background
+      // thread. Call this after setting the theme, before creating the
+      // window.
+      void                 warm_up_fonts();
+
    private:
 
 #if defined(ELEMENTS_HOST_UI_LIBRARY_COCOA)
@@ -44,6 +50,7 @@ namespace cycfi::elements
 #endif
 
       std::string          _app_name;
+      font_warm_up         _font_warm_up;
    };
 }
 
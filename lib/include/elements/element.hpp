@@ -7,6 +7,8 @@
 #define ELEMENTS_MAY_4_2016
 
 #include <elements/element/align.hpp>
+#include <elements/element/animated_image.hpp>
+#include <elements/element/async_image.hpp>
 #include <elements/element/button.hpp>
 #include <elements/element/child_window.hpp>
 #include <elements/element/collapsable.hpp>
@@ -33,9 +35,12 @@
 #include <elements/element/size.hpp>
 #include <elements/element/slider.hpp>
 #include <elements/element/status_bar.hpp>
+#include <elements/element/table.hpp>
 #include <elements/element/text.hpp>
+#include <elements/element/text_view.hpp>
 #include <elements/element/thumbwheel.hpp>
 #include <elements/element/tile.hpp>
+#include <elements/element/tiled_image.hpp>
 #include <elements/element/tooltip.hpp>
 
 // Include this last
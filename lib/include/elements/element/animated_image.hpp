@@ -0,0 +1,88 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_ANIMATED_IMAGE_OCTOBER_19_2026)
+#define ELEMENTS_ANIMATED_IMAGE_OCTOBER_19_2026
+
+#include <elements/element/element.hpp>
+#include <elements/support/pixmap.hpp>
+#include <infra/filesystem.hpp>
+#include <cstddef>
+#include <memory>
+
+namespace cycfi::elements
+{
+   /**
+    * \class animated_image
+    *
+    * \brief
+    *    Plays an animated WebP image, e.g. a busy indicator, without
+    *    hand-made sprite strips. Still WebP images work too.
+    *
+    *    Frames are decoded a few at a time on the image decoding worker
+    *    pool, and kept in a ring of at most `max_frames` frames. When the
+    *    whole animation fits in the ring, it is decoded only once.
+    *    Otherwise, the ring is refilled as frames are shown. Each frame is
+    *    shown for its own duration, on a view timer, and only the
+    *    element's bounds are refreshed.
+    *
+    *    Playback pauses while the element is not drawn (e.g. scrolled out
+    *    of view), and resumes when it is drawn again. It stops after the
+    *    animation's loop count, if it has one.
+    *
+    *    Throws `failed_to_load_pixmap` if the file is not a WebP image.
+    */
+   class animated_image : public element
+   {
+   public:
+
+      static constexpr std::size_t default_max_frames = 8;
+
+                              animated_image(
+                                 fs::path path
+                               , float scale = 1
+                               , std::size_t max_frames = default_max_frames
+                              );
+
+                              animated_image(animated_image const& rhs);
+                              animated_image(animated_image&& rhs);
+                              ~animated_image();
+
+      animated_image&         operator=(animated_image const& rhs) = delete;
+      animated_image&         operator=(animated_image&& rhs) = delete;
+
+      view_limits             limits(basic_context const& ctx) const override;
+      void                    draw(context const& ctx) override;
+
+      void                    play();
+      void                    stop();
+      bool                    is_playing() const         { return _playing; }
+      std::size_t             num_frames() const;
+
+   private:
+
+      class decoder;
+      using decoder_ptr = std::shared_ptr<decoder>;
+      using this_handle = std::shared_ptr<animated_image*>;
+      using this_weak_handle = std::weak_ptr<animated_image*>;
+
+      void                    start(view& v);
+      void                    tick(view& v, std::size_t generation);
+      void                    fill();
+
+      fs::path                _path;
+      float                   _scale;
+      std::size_t             _max_frames;
+      decoder_ptr             _decoder;
+      pixmap_ptr              _frame;
+      std::size_t             _generation = 0;  // Of the running clock
+      bool                    _playing = true;
+      bool                    _ticking = false;
+      bool                    _awaiting_draw = false;
+      this_handle             _this_handle;
+   };
+}
+
+#endif
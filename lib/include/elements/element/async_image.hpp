@@ -0,0 +1,89 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_ASYNC_IMAGE_OCTOBER_19_2026)
+#define ELEMENTS_ASYNC_IMAGE_OCTOBER_19_2026
+
+#include <elements/element/element.hpp>
+#include <elements/support/color.hpp>
+#include <elements/support/pixmap.hpp>
+#include <elements/support/pixmap_loader.hpp>
+#include <infra/filesystem.hpp>
+#include <memory>
+
+namespace cycfi::elements
+{
+   /**
+    * \class async_image
+    *
+    * \brief
+    *    An image that is loaded in the background.
+    *
+    *    The image file is decoded on a pool of worker threads, through the
+    *    shared pixmap cache, starting when the element is first laid out.
+    *    Until it is ready, the `placeholder` pixmap, if any, is drawn
+    *    instead, scaled to the image bounds. A low resolution preview of
+    *    the image makes a good placeholder. Without one, the bounds are
+    *    filled with the `placeholder_color`.
+    *
+    *    When the image is ready, the element is refreshed, or laid out
+    *    again if its size changed. The load is cancelled if the element
+    *    goes away first (e.g. a recycled `list` row), or if another image
+    *    is set.
+    *
+    *    Without a placeholder, the size of the image is not known until it
+    *    is loaded. Give the element a fixed size in layouts that should
+    *    not change.
+    */
+   class async_image : public element
+   {
+   public:
+
+                              async_image(
+                                 fs::path path
+                               , float scale = 1
+                               , pixmap_ptr placeholder = {}
+                              );
+
+                              async_image(async_image const& rhs);
+                              async_image(async_image&& rhs);
+                              ~async_image();
+
+      async_image&            operator=(async_image const& rhs);
+      async_image&            operator=(async_image&& rhs);
+
+      view_limits             limits(basic_context const& ctx) const override;
+      void                    layout(context const& ctx) override;
+      void                    draw(context const& ctx) override;
+
+      void                    set_image(fs::path path, float scale = 1);
+      pixmap_ptr              get_image() const          { return _pixmap; }
+      bool                    is_loading() const         { return _load != nullptr; }
+
+      void                    placeholder(pixmap_ptr pm) { _placeholder = pm; }
+      void                    placeholder_color(color c) { _placeholder_color = c; }
+
+   private:
+
+      using this_handle = std::shared_ptr<async_image*>;
+      using this_weak_handle = std::weak_ptr<async_image*>;
+
+      void                    start_load(view& v);
+      void                    cancel_load();
+      void                    loaded(view& v, std::size_t generation, pixmap_ptr pm);
+
+      fs::path                _path;
+      float                   _scale;
+      pixmap_ptr              _pixmap;
+      pixmap_ptr              _placeholder;
+      color                   _placeholder_color = colors::black.opacity(0.1);
+      pixmap_load_ptr         _load;
+      std::size_t             _generation = 0;  // Of the latest load
+      bool                    _failed = false;
+      this_handle             _this_handle;
+   };
+}
+
+#endif
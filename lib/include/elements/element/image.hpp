@@ -10,6 +10,7 @@
 #include <elements/element/proxy.hpp>
 #include <elements/support/canvas.hpp>
 #include <elements/support/pixmap.hpp>
+#include <elements/support/sprite_atlas.hpp>
 #include <infra/filesystem.hpp>
 #include <memory>
 
@@ -126,11 +127,15 @@ namespace cycfi::elements
     *    `basic_sprite` extends the `image` class to provide sprite-specific
     *    functionality. It subdivides an image into slices that can be
     *    indexed to display a particular frame.
+    *
+    *    The image can be a whole pixmap, or a region of a `sprite_atlas`
+    *    page shared with other sprites.
     */
    class basic_sprite : public image
    {
    public:
                               basic_sprite(char const* filename, float height, float scale = 1);
+                              basic_sprite(sprite_region const& region, float height);
 
       view_limits             limits(basic_context const& ctx) const override;
 
@@ -143,8 +148,11 @@ namespace cycfi::elements
 
    private:
 
+      rect                    region() const;
+
       size_t                  _index;
       float                   _height;
+      rect                    _region;    // In the pixmap. Empty for the whole pixmap.
    };
 
    using sprite = basic_sprite;
@@ -11,6 +11,7 @@
 #include <vector>
 #include <functional>
 #include <set>
+#include <algorithm>
 #include<iostream>
 
 namespace cycfi::elements
@@ -423,6 +424,25 @@ namespace cycfi::elements
       );
    }
 
+   /**
+    * \struct index_range
+    *
+    * \brief
+    *    A half-open range of indices, [first, last).
+    */
+   struct index_range
+   {
+      std::size_t             first = 0;
+      std::size_t             last = 0;
+
+      std::size_t             size() const { return last - first; }
+   };
+
+   using index_ranges = std::vector<index_range>;
+
+   index_ranges               to_ranges(std::vector<std::size_t> const& indices);
+   std::size_t                count_indices(index_ranges const& ranges);
+
    /**
     * \class list
     *
@@ -448,6 +468,8 @@ namespace cycfi::elements
       using composer_ptr = std::shared_ptr<cell_composer>;
       using indices_type = std::vector<std::size_t>;
 
+      static constexpr auto      npos = std::size_t(-1);
+
                                  list(composer_ptr composer, bool manage_externally = true);
                                  list(list const& rhs);
                                  list(list&& rhs);
@@ -463,8 +485,11 @@ namespace cycfi::elements
       void                       resize(size_t n);
       bool                       manage_externally() const { return _manage_externally; }
       void                       move(std::size_t pos, indices_type const& indices);
+      void                       move(std::size_t pos, index_ranges const& ranges);
       void                       insert(std::size_t pos, std::size_t num_items);
       void                       erase(indices_type const& indices);
+      void                       erase(index_ranges const& ranges);
+      void                       remap(indices_type const& from);
 
       rect                       bounds_of(context const& ctx, std::size_t ix) const override;
 
@@ -504,6 +529,7 @@ namespace cycfi::elements
       void                       move(basic_context const& ctx) const;
       void                       insert(basic_context const& ctx) const;
       void                       erase(basic_context const& ctx) const;
+      void                       remap(basic_context const& ctx) const;
 
       composer_ptr               _composer;
       bool                       _manage_externally;
@@ -518,15 +544,19 @@ namespace cycfi::elements
       mutable bool               _move_request:1;
       mutable bool               _insert_request:1;
       mutable bool               _erase_request:1;
+      mutable bool               _remap_request:1;
       mutable bool               _relinquish_focus_request:1;
+      mutable bool               _refocus_request:1;
+      mutable int                _refocus_index = -1;
 
       struct request_info
       {
          std::size_t                _move_pos;
-         std::vector<std::size_t>   _move_indices;
+         index_ranges               _move_ranges;
          std::size_t                _insert_pos;
          std::size_t                _insert_num_items;
-         std::vector<std::size_t>   _delete_indices;
+         index_ranges               _delete_ranges;
+         std::vector<std::size_t>   _remap_from;
       };
 
       using request_info_ptr = std::unique_ptr<request_info>;
@@ -573,6 +603,153 @@ namespace cycfi::elements
    // The old name is deprecated
    using hdynamic_list [[deprecated("Use hlist instead.")]] = hlist;
 
+   /**
+    * \class filtered_sorted_composer
+    *
+    * \brief
+    *    A cell composer adapter that presents a filtered and sorted view of
+    *    another (source) cell composer.
+    *
+    *    The adapter keeps a view-index to source-index mapping. `compose`
+    *    and `main_axis_size` are forwarded to the source using the mapped
+    *    index, so the source composer and its data are never rebuilt when
+    *    the filter or the sort order changes.
+    *
+    *    `filter`, `sort` and `refresh` recompute the mapping and return a
+    *    remap vector suitable for `list::remap`: for each new view index,
+    *    the previous view index of the same source item, or `list::npos`
+    *    if the item was not visible before. The list uses this to keep the
+    *    cells (and their composed elements) of items that survive the
+    *    change, instead of relayouting everything via `list::update`.
+    *
+    *    The remap assumes that source indices are stable. If the source
+    *    data itself is reordered, inserted into, or erased from, call
+    *    `refresh` followed by `list::update` instead. To grow or shrink the
+    *    source at its end, call `list::resize`, which remaps.
+    */
+   class filtered_sorted_composer : public cell_composer
+   {
+   public:
+
+      using composer_ptr = std::shared_ptr<cell_composer>;
+      using indices_type = std::vector<std::size_t>;
+      using predicate_function = std::function<bool(std::size_t index)>;
+      using compare_function = std::function<bool(std::size_t a, std::size_t b)>;
+
+                              filtered_sorted_composer(composer_ptr source);
+
+      std::size_t             size() const override;
+      void                    resize(size_t s) override;
+      element_ptr             compose(std::size_t index) override;
+      limits                  secondary_axis_limits(basic_context const& ctx) const override;
+      float                   main_axis_size(std::size_t index, basic_context const& ctx) const override;
+
+      indices_type            filter(predicate_function pred, bool refine = false);
+      indices_type            sort(compare_function comp);
+      indices_type            refresh();
+      indices_type            reset();
+      indices_type            resize_source(std::size_t s);
+
+      std::size_t             source_index(std::size_t index) const { return _map[index]; }
+      indices_type const&     mapping() const                       { return _map; }
+      composer_ptr const&     source() const                        { return _source; }
+
+   private:
+
+      indices_type            build() const;
+      void                    sort_map(indices_type& map) const;
+      indices_type            commit(indices_type map);
+
+      composer_ptr            _source;
+      indices_type            _map;
+      std::size_t             _source_size = 0;
+      predicate_function      _pred;
+      compare_function        _comp;
+   };
+
+   /**
+    * \brief
+    *    Create a `filtered_sorted_composer` over a source cell composer.
+    *
+    * \param source
+    *    The source cell composer.
+    *
+    * @return
+    *    Shared pointer to a `filtered_sorted_composer`.
+    */
+   inline auto filtered_sorted(std::shared_ptr<cell_composer> source)
+   {
+      return std::make_shared<filtered_sorted_composer>(std::move(source));
+   }
+
+   /**
+    * \brief
+    *    Utility function to move items in a vector `v` in the given index
+    *    `ranges` to a new position `pos`.
+    *
+    *    The moved elements retain their relative order. If the new position
+    *    is beyond the range of the vector, the elements will be moved to the
+    *    end of the vector. The ranges should be sorted, non-overlapping and
+    *    valid in vector `v`. The operation is done in a single linear pass,
+    *    regardless of the number of elements moved.
+    *
+    * \tparam T
+    *    The type of elements contained in the vector.
+    *
+    * \param v
+    *    Vector in which elements will be moved.
+    *
+    * \param pos
+    *    Target position in the vector (before the move) to which the
+    *    elements will be moved.
+    *
+    * \param ranges
+    *    Sorted ranges of the elements in vector `v` to be moved.
+    */
+   template <typename T>
+   inline void move_ranges(std::vector<T>& v, std::size_t pos, index_ranges const& ranges)
+   {
+      // Precondition: The ranges should be sorted, non-overlapping and
+      // validly pointing to items in vector `v`.
+      if (ranges.empty())
+         return;
+
+      std::vector<T> result;
+      result.reserve(v.size());
+
+      // Partition the items into: the non-moved items before `pos`, the
+      // moved items, and the non-moved items at or after `pos`.
+      auto append = [&](std::size_t first, std::size_t last)
+      {
+         for (auto i = first; i < last; ++i)
+            result.push_back(std::move(v[i]));
+      };
+
+      auto split = std::min(pos, v.size());
+      std::size_t i = 0;
+      for (auto const& r : ranges)
+      {
+         append(i, std::min(r.first, split));
+         i = std::max(i, r.last);
+      }
+      append(i, split);
+
+      for (auto const& r : ranges)
+         append(r.first, r.last);
+
+      i = split;
+      for (auto const& r : ranges)
+      {
+         if (r.last <= split)
+            continue;
+         append(i, r.first);
+         i = std::max(i, r.last);
+      }
+      append(i, v.size());
+
+      v = std::move(result);
+   }
+
    /**
     * \brief
     *    Utility function to move items in a vector `v` from given `indices`
@@ -582,7 +759,7 @@ namespace cycfi::elements
     *    indices to a specified position. The moved elements retain their
     *    relative order. If the new position is beyond the range of the
     *    vector, the elements will be moved to the end of the vector. The
-    *    indices should be valid indices in vector `v`.
+    *    indices should be sorted and valid indices in vector `v`.
     *
     * \tparam T
     *    The type of elements contained in the vector.
@@ -600,39 +777,49 @@ namespace cycfi::elements
    template <typename T>
    inline void move_indices(std::vector<T>& v, std::size_t pos, std::vector<std::size_t> const& indices)
    {
-      // Precondition: The indices should be validly pointing to items in vector `v`.
+      move_ranges(v, pos, to_ranges(indices));
+   }
 
-      // Reserve space for moved elements
-      std::vector<T> to_move;
-      to_move.reserve(indices.size());
+   /**
+    * \brief
+    *    Utility function to erase items from a vector `v` in the given index
+    *    `ranges`.
+    *
+    *    The surviving elements are compacted in a single linear pass. The
+    *    ranges should be sorted, non-overlapping and valid in vector `v`.
+    *
+    * \tparam T
+    *    The type of elements contained in the vector.
+    *
+    * \param v
+    *    Vector in which elements will be erased.
+    *
+    * \param ranges
+    *    Sorted ranges of the elements in vector `v` to be erased.
+    */
+   template <typename T>
+   inline void erase_ranges(std::vector<T>& v, index_ranges const& ranges)
+   {
+      // Precondition: The ranges should be sorted, non-overlapping and
+      // validly pointing to items in vector `v`.
+      if (ranges.empty())
+         return;
 
-      // Create a copy of the elements to be moved and erase the elements
-      // from their original positions. Iterating in reverse, after this
-      // operation, `to_move` will contain the items in reverse order.
-      for (auto i = indices.crbegin(); i != indices.crend(); ++i)
+      auto out = v.begin() + ranges.front().first;
+      for (std::size_t i = 0; i != ranges.size(); ++i)
       {
-         to_move.push_back(std::move(v[*i]));
-         v.erase(v.begin()+*i);
-         if (pos > *i)
-            --pos;
+         auto next = (i+1 != ranges.size())? ranges[i+1].first : v.size();
+         out = std::move(v.begin() + ranges[i].last, v.begin() + next, out);
       }
-
-      // Determine the insert position
-      auto pos_i = v.begin() + std::min(pos, v.size());
-
-      // Insert the elements at the new position in reverse order
-      v.insert(pos_i, to_move.crbegin(), to_move.crend());
+      v.erase(out, v.end());
    }
 
-   // Utility to erase items in a vector `v` with given `indices`.
-
    /**
     * \brief
     *    Utility function to erase items from a vector `v` at the given `indices`.
     *
-    *    This utility works by iterating over the indices vector in reverse
-    *    order and erasing each corresponding element from the vector `v`.
-    *    The indices vector should point to valid items in vector `v`.
+    *    The indices vector should be sorted and point to valid items in
+    *    vector `v`.
     *
     * \tparam T
     *    The type of elements contained in the vector.
@@ -647,9 +834,7 @@ namespace cycfi::elements
    template <typename T>
    inline void erase_indices(std::vector<T>& v, std::vector<std::size_t> const& indices)
    {
-      // Precondition: The indices should be validly pointing to items in vector `v`.
-      for (auto i = indices.crbegin(); i != indices.crend(); ++i)
-         v.erase(v.begin()+*i);
+      erase_ranges(v, to_ranges(indices));
    }
 
    //--------------------------------------------------------------------------
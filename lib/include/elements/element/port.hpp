@@ -9,6 +9,7 @@
 #include <elements/element/proxy.hpp>
 #include <infra/support.hpp>
 #include <memory>
+#include <chrono>
 
 namespace cycfi::elements
 {
@@ -196,12 +197,20 @@ namespace cycfi::elements
     * @var no_scrollbars:  Hides all scrollbars.
     * @var no_hscroll:     Disables horizontal scrolling.
     * @var no_vscroll:     Disables vertical scrolling.
+    * @var kinetic_scroll: Enables inertial scrolling. The content keeps
+    *                      gliding, with decaying velocity, after a burst of
+    *                      scroll events (e.g. a touchpad flick) ends.
+    * @var blit_scroll:    Scrolls by shifting previously rendered pixels,
+    *                      drawing only the newly exposed strip. See
+    *                      `scroller_base::invalidate`.
     */
    enum
    {
       no_scrollbars  = 1,
       no_hscroll     = 1 << 1,
-      no_vscroll     = 1 << 2
+      no_vscroll     = 1 << 2,
+      kinetic_scroll = 1 << 3,
+      blit_scroll    = 1 << 4
    };
 
    //--------------------------------------------------------------------------
@@ -221,6 +230,19 @@ namespace cycfi::elements
     *    of horizontal and vertical scrollbars based on the traits specified
     *    upon construction. It supports dynamic adjustment of content
     *    positioning within the scrollable area.
+    *
+    *    With the `kinetic_scroll` trait, the scroller tracks the velocity
+    *    of incoming scroll events. When the events stop, it keeps scrolling
+    *    on its own, driven by a frame timer, with the velocity decaying
+    *    exponentially. Positions are kept in sub-pixel precision, and each
+    *    frame repaints only the scroller's own bounds.
+    *
+    *    With the `blit_scroll` trait, the scroller keeps its rendered
+    *    content in a backing pixmap. A scroll step shifts the pixels by the
+    *    scroll delta and draws only the newly exposed strip through the
+    *    subject. Refreshes that do not scroll redraw only the damaged area
+    *    into the backing pixmap. Scroll offsets are snapped to whole pixels
+    *    to keep the blit exact.
     */
    class scroller_base : public port_element, public scrollable
    {
@@ -246,6 +268,7 @@ namespace cycfi::elements
       scroll_callback_f       on_scroll = [](point){};
 
       void                    set_alignment(point p);
+      void                    invalidate();
                               [[deprecated("use set_alignment(p) instead")]]
       void                    set_position(point p) { set_alignment(p); }
 
@@ -272,16 +295,46 @@ namespace cycfi::elements
          tracking_h
       };
 
+      struct backing_store;
+
+      using backing_ptr = std::shared_ptr<backing_store>;
+      using this_handle = std::shared_ptr<scroller_base*>;
+      using this_weak_handle = std::weak_ptr<scroller_base*>;
+      using time_point = std::chrono::steady_clock::time_point;
+
       scrollbar_bounds  get_scrollbar_bounds(context const& ctx);
       bool              reposition(context const& ctx, point p);
+      bool              scroll_by(context const& ctx, point dir);
+      bool              scroll_by(point dir);
+      void              track_velocity(context const& ctx, point dir);
+      void              coast(view& view_, int id);
+      void              stop_coasting();
+      point             scroll_offset(view_limits const& e_limits, rect const& bounds) const;
+      bool              draw_blit(context const& ctx);
+      void              render_backing(context const& ctx, rect area);
 
       bool              has_scrollbars() const { return !(_traits & no_scrollbars); }
       bool              allow_hscroll() const { return !(_traits & no_hscroll); }
       bool              allow_vscroll() const { return !(_traits & no_vscroll); }
 
+      bool              is_kinetic() const { return _traits & kinetic_scroll; }
+      bool              is_blit() const { return _traits & blit_scroll; }
+
       point             _offset;
       tracking_status   _tracking;
       int               _traits;
+
+      // Kinetic scrolling state
+      point             _scroll_range;    // Content size minus the viewport size
+      point             _velocity;        // Pixels per second
+      rect              _device_bounds;   // Scroller bounds in device coordinates
+      time_point        _last_scroll;
+      int               _coast_id = 0;
+      this_handle       _this_handle;
+
+      // Blit scrolling state
+      backing_ptr       _backing;
+      bool              _content_dirty = true;
    };
 
    //--------------------------------------------------------------------------
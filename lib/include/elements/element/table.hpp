@@ -0,0 +1,235 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_TABLE_OCTOBER_19_2026)
+#define ELEMENTS_TABLE_OCTOBER_19_2026
+
+#include <elements/element/element.hpp>
+#include <elements/support/fenwick_tree.hpp>
+#include <elements/support/context.hpp>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+namespace cycfi::elements
+{
+   /**
+    * \class table_composer
+    *
+    * \brief
+    *    An abstract base for classes that compose the cells of a `table`.
+    *
+    *    The row and column axes are independent: the height of a row and the
+    *    width of a column are queried separately, and a cell is composed
+    *    only when it becomes visible.
+    */
+   class table_composer : public std::enable_shared_from_this<table_composer>
+   {
+   public:
+
+      virtual                 ~table_composer() = default;
+
+      virtual std::size_t     num_rows() const = 0;
+      virtual std::size_t     num_columns() const = 0;
+      virtual float           row_height(std::size_t row, basic_context const& ctx) const = 0;
+      virtual float           column_width(std::size_t col, basic_context const& ctx) const = 0;
+      virtual element_ptr     compose(std::size_t row, std::size_t col) = 0;
+   };
+
+   /**
+    * \class function_table_composer
+    *
+    * \brief
+    *    A table composer with a fixed number of rows and columns, fixed row
+    *    height and column width, that composes the cells using a provided
+    *    function.
+    *
+    * \tparam F
+    *    The function type used to compose the cells, with the signature
+    *    `element_ptr(std::size_t row, std::size_t col)`.
+    */
+   template <typename F>
+   class function_table_composer : public table_composer
+   {
+   public:
+                              function_table_composer(
+                                 std::size_t rows, std::size_t columns
+                               , float row_height, float column_width
+                               , F compose_
+                              )
+                               : _rows{rows}
+                               , _columns{columns}
+                               , _row_height{row_height}
+                               , _column_width{column_width}
+                               , _compose(std::move(compose_))
+                              {}
+
+      std::size_t             num_rows() const override     { return _rows; }
+      std::size_t             num_columns() const override  { return _columns; }
+      float                   row_height(std::size_t, basic_context const&) const override { return _row_height; }
+      float                   column_width(std::size_t, basic_context const&) const override { return _column_width; }
+      element_ptr             compose(std::size_t row, std::size_t col) override { return _compose(row, col); }
+
+   private:
+
+      std::size_t             _rows;
+      std::size_t             _columns;
+      float                   _row_height;
+      float                   _column_width;
+      F                       _compose;
+   };
+
+   /**
+    * \brief
+    *    Create a basic table composer given the number of rows and columns,
+    *    the row height, the column width and a compose function.
+    *
+    * \tparam F
+    *    The function type used for composing cells.
+    *
+    * @return
+    *    Shared pointer to a table composer.
+    */
+   template <typename F>
+   inline auto basic_table_composer(
+      std::size_t rows, std::size_t columns
+    , float row_height, float column_width
+    , F&& compose
+   )
+   {
+      using ftype = remove_cvref_t<F>;
+      return std::make_shared<function_table_composer<ftype>>(
+         rows, columns, row_height, column_width, std::forward<F>(compose)
+      );
+   }
+
+   /**
+    * \class table
+    *
+    * \brief
+    *    A two-dimensional table of cells, virtualized along both axes.
+    *
+    *    The table is meant to be placed inside a `scroller`. Only the cells
+    *    that intersect the visible area are composed and held in memory;
+    *    cells that scroll out of view are released. Row and column offsets
+    *    are kept in Fenwick trees, so locating the visible range, hit
+    *    testing, and resizing a single row or column are O(log n). Drawing
+    *    and hit testing are thus proportional to the number of visible
+    *    cells, not to the size of the table.
+    *
+    *    The first `frozen_rows` rows and `frozen_columns` columns are
+    *    headers. They stay pinned to the top and left edges of the visible
+    *    area while the rest of the table scrolls.
+    */
+   class table : public element
+   {
+   public:
+
+      using composer_ptr = std::shared_ptr<table_composer>;
+
+      struct cell_index
+      {
+         std::size_t          row = std::size_t(-1);
+         std::size_t          col = std::size_t(-1);
+
+         bool                 is_valid() const { return row != std::size_t(-1); }
+         bool                 operator==(cell_index const&) const = default;
+      };
+
+                              table(
+                                 composer_ptr composer
+                               , std::size_t frozen_rows = 0
+                               , std::size_t frozen_columns = 0
+                              );
+
+      view_limits             limits(basic_context const& ctx) const override;
+      void                    draw(context const& ctx) override;
+      void                    layout(context const& ctx) override;
+      element*                hit_test(context const& ctx, point p, bool leaf, bool control) override;
+
+      bool                    wants_control() const override { return true; }
+      bool                    click(context const& ctx, mouse_button btn) override;
+      void                    drag(context const& ctx, mouse_button btn) override;
+      bool                    cursor(context const& ctx, point p, cursor_tracking status) override;
+      bool                    scroll(context const& ctx, point dir, point p) override;
+
+      void                    update();
+      void                    resize_row(std::size_t row);
+      void                    resize_column(std::size_t col);
+
+      std::size_t             num_rows() const        { return _rows.size(); }
+      std::size_t             num_columns() const     { return _columns.size(); }
+      std::size_t             frozen_rows() const     { return _frozen_rows; }
+      std::size_t             frozen_columns() const  { return _frozen_columns; }
+
+      cell_index              cell_at(context const& ctx, point p) const;
+      rect                    bounds_of(context const& ctx, std::size_t row, std::size_t col) const;
+
+   private:
+
+      struct cell_info
+      {
+         element_ptr          elem_ptr;
+         int                  layout_id = -1;
+      };
+
+      // Offsets of the frozen rows and columns, pinning them to the
+      // visible area, and their total size.
+      struct shift_info
+      {
+         float                x = 0;
+         float                y = 0;
+         float                frozen_w = 0;
+         float                frozen_h = 0;
+      };
+
+      using key_type = std::uint64_t;
+      using cells_map = std::unordered_map<key_type, cell_info>;
+
+      static key_type         make_key(std::size_t row, std::size_t col);
+      void                    sync(basic_context const& ctx) const;
+      shift_info              frozen_shift(rect const& bounds, rect const& visible) const;
+      rect                    bounds_of(rect const& bounds, shift_info const& shift, std::size_t row, std::size_t col) const;
+      cell_index              cell_at(rect const& bounds, shift_info const& shift, point p) const;
+      cell_info&              get_cell(std::size_t row, std::size_t col) const;
+      void                    draw_cells(
+                                 context const& ctx, shift_info const& shift, rect clip_
+                               , std::size_t row_first, std::size_t row_last
+                               , std::size_t col_first, std::size_t col_last
+                              );
+
+      template <typename F>
+      bool                    with_cell(context const& ctx, cell_index ix, F&& f);
+
+      composer_ptr            _composer;
+      std::size_t             _frozen_rows;
+      std::size_t             _frozen_columns;
+
+      mutable fenwick_tree<double> _rows;
+      mutable fenwick_tree<double> _columns;
+      mutable cells_map       _cells;
+      mutable bool            _update_request = true;
+      mutable std::vector<std::size_t> _resized_rows;
+      mutable std::vector<std::size_t> _resized_columns;
+
+      int                     _layout_id = 0;
+      point                   _previous_size;
+      cell_index              _click_tracking;
+      cell_index              _cursor_tracking;
+   };
+
+   //--------------------------------------------------------------------------
+   // Inlines
+   //--------------------------------------------------------------------------
+
+   inline table::key_type table::make_key(std::size_t row, std::size_t col)
+   {
+      return (key_type(row) << 32) | key_type(col & 0xffffffff);
+   }
+}
+
+#endif
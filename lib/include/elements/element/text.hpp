@@ -70,9 +70,30 @@ namespace cycfi::elements
       color                   get_color() const          { return _color; }
       point                   current_size() const       { return _current_size; };
 
+   protected:
+
+      void                    replace_text(std::size_t pos, std::size_t count, string_view ins);
+
    private:
 
+      // A paragraph starts at the beginning of the text or at a newline.
+      // Each one keeps its own shaped glyph run and its rows, broken at
+      // `width`, so that an edit only reshapes the paragraphs it touches.
+      struct paragraph
+      {
+         std::size_t          start;         // Byte offset into _text
+         master_glyphs        run;
+         std::vector<glyphs>  rows;
+         float                width = -1;    // The width the rows were broken at
+      };
+
+      using paragraphs = std::vector<paragraph>;
+
       void                    sync() const;
+      void                    rebuild() const;
+      void                    split(std::size_t first, std::size_t last, paragraphs& out) const;
+      void                    relocate() const;
+      void                    break_rows(float width);
 
    protected:
 
@@ -81,6 +102,10 @@ namespace cycfi::elements
       std::vector<glyphs>     _rows;
       color                   _color;
       point                   _current_size = {-1, -1};
+
+   private:
+
+      mutable paragraphs      _paragraphs;
    };
 
    ////////////////////////////////////////////////////////////////////////////
@@ -156,21 +181,40 @@ namespace cycfi::elements
 
       char const*             caret_position(context const& ctx, point p);
       glyph_metrics           glyph_info(context const& ctx, char const* s);
+      void                    edit(std::size_t pos, std::size_t count, string_view ins);
 
    private:
 
-      struct state_saver;
-      using state_saver_f = std::function<void()>;
+      // Undo records edits, not snapshots of the text. A typing run is
+      // kept open and merged into a single step until another command
+      // closes it.
+      struct edit_op
+      {
+         std::size_t          pos;
+         std::string          removed;
+         std::string          inserted;
+      };
 
-      state_saver_f           capture_state();
+      struct undo_step
+      {
+         std::vector<edit_op> ops;
+         int                  select_start[2];  // Before and after
+         int                  select_end[2];    // Before and after
+         std::size_t          text_size[2];     // Before and after, to detect stale steps
+      };
 
+      using undo_step_ptr = std::shared_ptr<undo_step>;
       using this_handle = std::shared_ptr<basic_text_box*>;
       using this_weak_handle = std::weak_ptr<basic_text_box*>;
 
+      void                    open_undo();
+      void                    close_undo(view& v);
+      void                    apply_undo(undo_step const& step, bool redo);
+
       int                     _select_start;
       int                     _select_end;
       float                   _current_x;
-      state_saver_f           _typing_state;
+      undo_step_ptr           _undo_step;
       bool                    _is_focus : 1;
       bool                    _show_caret : 1;
       bool                    _caret_started : 1;
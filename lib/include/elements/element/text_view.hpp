@@ -0,0 +1,126 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_TEXT_VIEW_OCTOBER_19_2026)
+#define ELEMENTS_TEXT_VIEW_OCTOBER_19_2026
+
+#include <elements/element/element.hpp>
+#include <elements/support/glyphs.hpp>
+#include <elements/support/text_buffer.hpp>
+#include <elements/support/theme.hpp>
+#include <infra/filesystem.hpp>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+namespace cycfi::elements
+{
+   struct failed_to_open_text_file : std::runtime_error
+   {
+      using std::runtime_error::runtime_error;
+   };
+
+   /**
+    * \class text_view
+    *
+    * \brief
+    *    A read-only view of a text file of any size, such as a multi-gigabyte
+    *    log.
+    *
+    *    The file is not loaded. The start of each line is found by a
+    *    background thread, reading the file a chunk at a time, and the view
+    *    grows as the lines are indexed. Only the visible lines are read and
+    *    shaped, when drawn, so drawing is O(visible lines) regardless of the
+    *    file size. Place it inside a `vscroller`.
+    *
+    *    With `follow_tail` on, the file is checked periodically for growth.
+    *    New lines are appended, and if the view was scrolled to the bottom,
+    *    it stays at the bottom.
+    *
+    *    The file may be truncated at any time, e.g. by log rotation. It is
+    *    read rather than memory mapped for that reason: reading a mapping
+    *    past the new end of the file would crash with SIGBUS, while a read
+    *    just comes up short. Lines read short until the truncation is
+    *    noticed (within a poll period, with `follow_tail` on) show what is
+    *    left of them; the view then starts over from the new contents.
+    *
+    *    The text may also be a `text_buffer`, e.g. a large document being
+    *    edited. It is indexed and read piece by piece, without flattening
+    *    it, and `text` replaces it with an edited snapshot.
+    *
+    *    Lines are not wrapped. Only the first `max_line_bytes` of a line
+    *    are shaped.
+    *
+    *    Throws `failed_to_open_text_file` if the file cannot be opened.
+    */
+   class text_view : public element
+   {
+   public:
+
+      static constexpr std::size_t max_line_bytes = 4096;
+
+                              text_view(
+                                 fs::path path
+                               , font font_        = get_theme().text_box_font
+                               , color color_      = get_theme().text_box_font_color
+                              );
+
+                              text_view(
+                                 text_buffer text
+                               , font font_        = get_theme().text_box_font
+                               , color color_      = get_theme().text_box_font_color
+                              );
+
+                              text_view(text_view&& rhs) = default;
+                              ~text_view();
+
+      view_limits             limits(basic_context const& ctx) const override;
+      void                    layout(context const& ctx) override;
+      void                    draw(context const& ctx) override;
+
+      fs::path const&         path() const;
+      std::size_t             num_lines() const          { return _num_lines; }
+      bool                    is_indexing() const;
+      void                    text(text_buffer text_, std::size_t changed = 0);
+
+      void                    follow_tail(bool follow)   { _follow_tail = follow; }
+      bool                    follow_tail() const        { return _follow_tail; }
+
+      void                    set_color(color c)         { _color = c; }
+      color                   get_color() const          { return _color; }
+
+   private:
+
+      struct document;
+      using document_ptr = std::shared_ptr<document>;
+      using this_handle = std::shared_ptr<text_view*>;
+      using this_weak_handle = std::weak_ptr<text_view*>;
+
+      struct shaped_line
+      {
+         std::size_t          line;
+         std::unique_ptr<char[]> text;       // The glyphs refer to it
+         master_glyphs        glyphs;
+      };
+
+      float                   line_height() const;
+      void                    shape(std::size_t first, std::size_t last);
+      shaped_line             shape(std::size_t line) const;
+      void                    start_polling(view& v);
+      void                    poll(view& v);
+
+      document_ptr            _doc;
+      std::size_t             _version = 0;  // Of the document, when _lines were shaped
+      master_glyphs           _layout;       // Font and metrics source only
+      color                   _color;
+      std::deque<shaped_line> _lines;        // Shaped lines, in order, with no gaps
+      std::size_t             _num_lines = 0;
+      bool                    _follow_tail = false;
+      bool                    _polling = false;
+      this_handle             _this_handle;
+   };
+}
+
+#endif
@@ -0,0 +1,215 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_TILED_IMAGE_OCTOBER_19_2026)
+#define ELEMENTS_TILED_IMAGE_OCTOBER_19_2026
+
+#include <elements/element/element.hpp>
+#include <elements/support/pixmap.hpp>
+#include <elements/support/pixmap_loader.hpp>
+#include <infra/filesystem.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace cycfi::elements
+{
+   /**
+    * \class tile_source
+    *
+    * \brief
+    *    The tiles of a large image, at a number of zoom levels. Level 0 is
+    *    the full resolution image, and each level after that is half the
+    *    size of the one before. Tiles are square, `tile_size` pixels on a
+    *    side, except along the right and bottom edges.
+    *
+    *    `tile` is called from worker threads, possibly several at once.
+    */
+   class tile_source
+   {
+   public:
+
+      virtual                 ~tile_source() = default;
+
+      virtual extent          size() const = 0;       // Pixels, at level 0
+      virtual std::size_t     tile_size() const = 0;
+      virtual std::size_t     num_levels() const;
+      virtual pixmap_ptr      tile(std::size_t level, std::size_t col, std::size_t row) const = 0;
+
+      extent                  level_size(std::size_t level) const;
+   };
+
+   using tile_source_ptr = std::shared_ptr<tile_source const>;
+
+   /**
+    * \class tile_pyramid
+    *
+    * \brief
+    *    Tiles stored as image files, in a directory per level:
+    *    `<dir>/<level>/<col>_<row><ext>`, e.g. `schematic/2/10_4.png`.
+    */
+   class tile_pyramid : public tile_source
+   {
+   public:
+                              tile_pyramid(
+                                 fs::path dir
+                               , extent size
+                               , std::size_t tile_size = 256
+                               , std::string ext = ".png"
+                              );
+
+      extent                  size() const override         { return _size; }
+      std::size_t             tile_size() const override    { return _tile_size; }
+      pixmap_ptr              tile(std::size_t level, std::size_t col, std::size_t row) const override;
+
+   private:
+
+      fs::path                _dir;
+      extent                  _size;
+      std::size_t             _tile_size;
+      std::string             _ext;
+   };
+
+   /**
+    * \class tile_generator
+    *
+    * \brief
+    *    Tiles rendered on the fly by a function, e.g. from a spectrogram's
+    *    data. The function is called from worker threads.
+    */
+   class tile_generator : public tile_source
+   {
+   public:
+
+      using generate_function =
+         std::function<pixmap_ptr(std::size_t level, std::size_t col, std::size_t row)>;
+
+                              tile_generator(
+                                 extent size
+                               , generate_function generate
+                               , std::size_t tile_size = 256
+                              );
+
+      extent                  size() const override         { return _size; }
+      std::size_t             tile_size() const override    { return _tile_size; }
+      pixmap_ptr              tile(std::size_t level, std::size_t col, std::size_t row) const override;
+
+   private:
+
+      extent                  _size;
+      generate_function       _generate;
+      std::size_t             _tile_size;
+   };
+
+   /**
+    * \class tiled_image
+    *
+    * \brief
+    *    Displays an image too large to be held in memory as one surface,
+    *    a tile at a time. Place it inside a `scroller`.
+    *
+    *    Only the visible tiles are drawn, from the level that best matches
+    *    the zoom and the display's resolution. Missing tiles are decoded on
+    *    the image decoding worker pool, and the element refreshes as they
+    *    arrive. Meanwhile, the area is drawn from a coarser level, if one
+    *    is cached. Requests for tiles that scroll out of view before they
+    *    are decoded are cancelled.
+    *
+    *    Decoded tiles are kept in a least recently used cache, bounded by
+    *    `budget` bytes, except that the tiles on screen are always kept.
+    *    Drawing does not depend on the size of the image, only on the
+    *    number of visible tiles.
+    *
+    *    The element is the size of the image times the zoom. Lay out the
+    *    view again after changing the zoom.
+    */
+   class tiled_image : public element
+   {
+   public:
+
+      static constexpr std::size_t default_budget = 64 * 1024 * 1024;
+
+                              tiled_image(tile_source_ptr source, float zoom = 1);
+                              tiled_image(tiled_image const& rhs);
+                              tiled_image(tiled_image&& rhs);
+                              ~tiled_image();
+
+      tiled_image&            operator=(tiled_image const& rhs) = delete;
+      tiled_image&            operator=(tiled_image&& rhs) = delete;
+
+      view_limits             limits(basic_context const& ctx) const override;
+      void                    draw(context const& ctx) override;
+
+      float                   zoom() const                  { return _zoom; }
+      void                    zoom(float zoom_);
+
+      std::size_t             budget() const                { return _budget; }
+      void                    budget(std::size_t bytes);
+      std::size_t             bytes() const                 { return _bytes; }
+
+   private:
+
+      using this_handle = std::shared_ptr<tiled_image*>;
+      using this_weak_handle = std::weak_ptr<tiled_image*>;
+
+      struct tile_key
+      {
+         std::uint32_t        level;
+         std::uint32_t        col;
+         std::uint32_t        row;
+
+         bool                 operator==(tile_key const& rhs) const;
+      };
+
+      struct tile_key_hash
+      {
+         std::size_t          operator()(tile_key const& k) const;
+      };
+
+      struct tile
+      {
+         tile_key             key;
+         pixmap_ptr           pixmap;     // Null if the tile could not be made
+         std::size_t          bytes;
+      };
+
+      // A range of tiles of a level, e.g. those on screen
+      struct tile_range
+      {
+         std::uint32_t        level = 0;
+         std::size_t          first_col = 0, last_col = 0;
+         std::size_t          first_row = 0, last_row = 0;
+
+         bool                 contains(tile_key k) const;
+      };
+
+      using tile_list = std::list<tile>;
+      using tile_map = std::unordered_map<tile_key, tile_list::iterator, tile_key_hash>;
+      using pending_map = std::unordered_map<tile_key, pixmap_load_ptr, tile_key_hash>;
+
+      tile const*             find(tile_key k);
+      void                    insert(tile_key k, pixmap_ptr pm);
+      void                    trim();
+      void                    request(view& v, tile_key k);
+      void                    loaded(view& v, tile_key k, pixmap_ptr pm);
+      void                    draw_fallback(canvas& cnv, tile_key k, rect dest, float pixel);
+
+      tile_source_ptr         _source;
+      float                   _zoom;
+      std::size_t             _budget = default_budget;
+      std::size_t             _bytes = 0;
+      tile_list               _tiles;        // Most recently used first
+      tile_map                _map;
+      pending_map             _pending;
+      tile_range              _shown;        // The tiles on screen, as of the last draw
+      this_handle             _this_handle;
+   };
+}
+
+#endif
@@ -15,10 +15,17 @@
 #include <elements/support/font.hpp>
 #include <elements/support/glyphs.hpp>
 #include <elements/support/icon_ids.hpp>
+#include <elements/support/mapped_file.hpp>
 #include <elements/support/pixmap.hpp>
+#include <elements/support/pixmap_cache.hpp>
+#include <elements/support/pixmap_loader.hpp>
 #include <elements/support/point.hpp>
 #include <elements/support/rect.hpp>
 #include <elements/support/draw_utils.hpp>
+#include <elements/support/shadow.hpp>
+#include <elements/support/shaped_text_cache.hpp>
+#include <elements/support/sprite_atlas.hpp>
+#include <elements/support/text_buffer.hpp>
 #include <elements/support/text_utils.hpp>
 #include <elements/support/theme.hpp>
 
@@ -46,6 +46,7 @@ namespace cycfi { namespace elements
       void              skew(float sx, float sy);
       point             device_to_user(point p);
       point             user_to_device(point p);
+      float             pixel_ratio() const;
 
       ///////////////////////////////////////////////////////////////////////////////////
       // Paths
@@ -180,6 +181,7 @@ namespace cycfi { namespace elements
       void              stroke_text(std::string_view utf8, point p);
 
       text_metrics      measure_text(char const* utf8);
+      text_metrics      measure_text(std::string_view utf8);
       void              text_align(int align);
 
       font_metrics      measure_font();
@@ -0,0 +1,101 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_DETAIL_FONT_INDEX_OCTOBER_19_2026)
+#define ELEMENTS_DETAIL_FONT_INDEX_OCTOBER_19_2026
+
+#include <elements/support/mapped_file.hpp>
+#include <infra/filesystem.hpp>
+#include <infra/string_view.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace cycfi { namespace elements { namespace detail
+{
+   /**
+    * \class font_index
+    *
+    * \brief
+    *    A persistent, memory mapped index of the installed fonts: their
+    *    families, weights, slants, stretches and file paths.
+    *
+    *    Enumerating the fonts with fontconfig can take hundreds of
+    *    milliseconds on systems with many fonts. The index is saved after
+    *    the first enumeration. On the next start, it is mapped, and only the
+    *    families actually asked for are looked up.
+    *
+    *    The index records the font directories, and all their
+    *    subdirectories, with their modification times. It is rejected if
+    *    any of them has changed (e.g. a font was installed), if the
+    *    application's font directories are not the same, or if the version
+    *    does not match.
+    *
+    *    File layout (native byte order, all offsets from the start of the
+    *    file):
+    *
+    *       header
+    *       directory records, `num_dirs`
+    *       family records, `num_families`, sorted by name
+    *       face records, `num_faces`, grouped by family
+    *       strings
+    */
+   class font_index
+   {
+   public:
+
+      static constexpr std::uint32_t version = 1;
+
+      struct face
+      {
+         string_view          full_name;
+         string_view          file;
+         std::uint8_t         weight;
+         std::uint8_t         slant;
+         std::uint8_t         stretch;
+      };
+
+      struct family
+      {
+         string_view          name;
+         std::vector<face>    faces;
+      };
+
+      struct directory
+      {
+         fs::path             path;
+         bool                 app;        // One of the application's font directories
+      };
+
+      bool                    load(fs::path const& path, std::vector<fs::path> const& app_dirs);
+      bool                    is_loaded() const       { return !_file.empty(); }
+      bool                    find(string_view family, std::vector<face>& faces) const;
+
+      static bool             save(
+                                 fs::path const& path
+                               , std::vector<directory> const& dirs
+                               , std::vector<family> const& families
+                              );
+
+   private:
+
+      struct header;
+      struct dir_record;
+      struct family_record;
+      struct face_record;
+
+      template <typename T>
+      T                       read(std::size_t offset) const;
+      bool                    get_string(std::uint32_t offset, std::uint32_t size, string_view& str) const;
+      bool                    validate(std::vector<fs::path> const& app_dirs);
+
+      mapped_file             _file;
+      std::uint32_t           _num_families = 0;
+      std::uint32_t           _num_faces = 0;
+      std::size_t             _families = 0;  // Offset of the family records
+      std::size_t             _faces = 0;     // Offset of the face records
+   };
+}}}
+
+#endif
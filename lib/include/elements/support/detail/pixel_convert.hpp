@@ -0,0 +1,87 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_DETAIL_PIXEL_CONVERT_OCTOBER_19_2026)
+#define ELEMENTS_DETAIL_PIXEL_CONVERT_OCTOBER_19_2026
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cycfi::elements::detail
+{
+   /**
+    * \brief
+    *    Convert `width` x `height` pixels of straight (non premultiplied)
+    *    RGBA, as image decoders produce them, to Cairo's ARGB32: native
+    *    endian 32-bit pixels with premultiplied alpha. The swizzle and the
+    *    premultiplication are done in one pass.
+    *
+    *    The strides are in bytes, and may be larger than `width * 4`.
+    *    `src` and `dest` may be the same buffer (with the same stride), but
+    *    may not otherwise overlap.
+    *
+    *    The kernel (AVX2, SSE2, NEON or plain C++) is selected at runtime,
+    *    the first time this is called. All give exactly the same results.
+    */
+   void rgba_to_premultiplied_argb(
+      std::uint8_t const* src, std::size_t src_stride
+    , std::uint8_t* dest, std::size_t dest_stride
+    , std::size_t width, std::size_t height
+   );
+
+   /**
+    * \brief
+    *    Downsample `width` x `height` 32-bit pixels to half their size,
+    *    rounding down but at least 1 x 1, averaging each 2 x 2 block. The
+    *    channels are averaged independently, so it works for any 32-bit
+    *    format, but alpha must be premultiplied for the result to be
+    *    correct. Along an odd edge, the last row or column is dropped
+    *    (except when it is the only one).
+    *
+    *    Uses the same kernel selection as `rgba_to_premultiplied_argb`.
+    */
+   void downsample_half(
+      std::uint8_t const* src, std::size_t src_stride
+    , std::size_t width, std::size_t height
+    , std::uint8_t* dest, std::size_t dest_stride
+   );
+
+   /**
+    * \brief
+    *    Blur `width` x `height` 32-bit pixels in place with a box filter
+    *    `2 * radius + 1` pixels wide, along the rows, then along the
+    *    columns. Pixels outside the image count as transparent. Like
+    *    `downsample_half`, it filters the channels independently, so alpha
+    *    must be premultiplied.
+    *
+    *    Uses a running sum, so the cost does not depend on the radius.
+    */
+   void box_blur(
+      std::uint8_t* data, std::size_t stride
+    , std::size_t width, std::size_t height
+    , std::size_t radius
+   );
+
+   /**
+    * \brief
+    *    Blur `width` x `height` 32-bit pixels in place, approximating a
+    *    Gaussian blur with a standard deviation of `sigma` pixels by three
+    *    box blurs. As with `box_blur`, alpha must be premultiplied.
+    */
+   void gaussian_blur(
+      std::uint8_t* data, std::size_t stride
+    , std::size_t width, std::size_t height
+    , float sigma
+   );
+
+   /**
+    * \brief
+    *    The name of the kernel the pixel conversions use:
+    *    "avx2", "sse2", "neon" or "scalar".
+    */
+   char const* pixel_convert_kernel();
+}
+
+#endif
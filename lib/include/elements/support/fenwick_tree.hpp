@@ -0,0 +1,154 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_FENWICK_TREE_OCTOBER_19_2026)
+#define ELEMENTS_FENWICK_TREE_OCTOBER_19_2026
+
+#include <vector>
+#include <cstddef>
+
+namespace cycfi::elements
+{
+   /**
+    * \class fenwick_tree
+    *
+    * \brief
+    *    A Fenwick (binary indexed) tree of non-negative sizes, used for
+    *    keeping cumulative offsets of variable-sized items such as rows and
+    *    columns.
+    *
+    *    Building the tree is O(n). Changing the size of a single item,
+    *    getting the offset of an item, and finding the item at a given
+    *    offset are all O(log n).
+    *
+    * \tparam T
+    *    The size type.
+    */
+   template <typename T = double>
+   class fenwick_tree
+   {
+   public:
+
+      template <typename F>
+      void                    build(std::size_t n, F&& size_of);
+      void                    clear();
+
+      std::size_t             size() const            { return _values.size(); }
+      bool                    empty() const           { return _values.empty(); }
+      T                       total() const           { return _total; }
+      T                       operator[](std::size_t i) const { return _values[i]; }
+
+      T                       offset(std::size_t i) const;
+      void                    set(std::size_t i, T val);
+      std::size_t             find(T pos) const;
+
+   private:
+
+      static std::size_t      lowbit(std::size_t i) { return i & (~i + 1); }
+
+      std::vector<T>          _tree;   // 1-based
+      std::vector<T>          _values;
+      T                       _total = 0;
+   };
+
+   //--------------------------------------------------------------------------
+   // Inlines
+   //--------------------------------------------------------------------------
+
+   /**
+    * \brief
+    *    Build the tree in O(n).
+    *
+    * \param n
+    *    The number of items.
+    *
+    * \param size_of
+    *    A function that returns the size of the item at a given index.
+    */
+   template <typename T>
+   template <typename F>
+   inline void fenwick_tree<T>::build(std::size_t n, F&& size_of)
+   {
+      _values.resize(n);
+      _tree.assign(n+1, T{0});
+      _total = 0;
+      for (std::size_t i = 0; i != n; ++i)
+      {
+         _values[i] = size_of(i);
+         _total += _values[i];
+         _tree[i+1] += _values[i];
+         auto j = (i+1) + lowbit(i+1);
+         if (j <= n)
+            _tree[j] += _tree[i+1];
+      }
+   }
+
+   template <typename T>
+   inline void fenwick_tree<T>::clear()
+   {
+      _tree.clear();
+      _values.clear();
+      _total = 0;
+   }
+
+   /**
+    * \brief
+    *    Get the offset of item `i`; the sum of the sizes of all items
+    *    before it. `offset(size())` is the total.
+    */
+   template <typename T>
+   inline T fenwick_tree<T>::offset(std::size_t i) const
+   {
+      T sum = 0;
+      for (; i > 0; i -= lowbit(i))
+         sum += _tree[i];
+      return sum;
+   }
+
+   /**
+    * \brief
+    *    Set the size of item `i`.
+    */
+   template <typename T>
+   inline void fenwick_tree<T>::set(std::size_t i, T val)
+   {
+      auto delta = val - _values[i];
+      _values[i] = val;
+      _total += delta;
+      for (++i; i < _tree.size(); i += lowbit(i))
+         _tree[i] += delta;
+   }
+
+   /**
+    * \brief
+    *    Find the item that contains the offset `pos`; the index `i` such
+    *    that `offset(i) <= pos < offset(i+1)`. Returns `size()` if `pos` is
+    *    at or beyond the total.
+    */
+   template <typename T>
+   inline std::size_t fenwick_tree<T>::find(T pos) const
+   {
+      auto n = _values.size();
+      if (pos < 0)
+         return 0;
+
+      std::size_t step = 1;
+      while ((step << 1) <= n)
+         step <<= 1;
+
+      std::size_t i = 0;
+      for (; step; step >>= 1)
+      {
+         if (i + step <= n && _tree[i + step] <= pos)
+         {
+            i += step;
+            pos -= _tree[i];
+         }
+      }
+      return i;
+   }
+}
+
+#endif
@@ -8,6 +8,9 @@
 
 #include <infra/string_view.hpp>
 #include <infra/filesystem.hpp>
+#include <infra/support.hpp>
+#include <atomic>
+#include <thread>
 #include <vector>
 
 extern "C"
@@ -114,6 +117,38 @@ namespace cycfi { namespace elements
       float               _size     = 12;
    };
 
+   /**
+    * \class font_warm_up
+    *
+    * \brief
+    *    Enumerates the installed fonts and loads the faces of a set of font
+    *    descriptors on a background thread, so that the first frame does not
+    *    have to.
+    *
+    *    Fonts may be created on other threads while the warm-up is running.
+    *    These wait only for what is not there yet: if the fonts are still
+    *    being enumerated, a lookup waits for the enumeration to finish. Faces
+    *    already loaded are shared.
+    *
+    *    The destructor waits for the warm-up to finish.
+    */
+   class font_warm_up : non_copyable
+   {
+   public:
+                           font_warm_up() = default;
+      explicit             font_warm_up(std::vector<font_descr> const& descrs);
+                           ~font_warm_up();
+
+      void                 start(std::vector<font_descr> const& descrs);
+      void                 wait();
+      bool                 is_done() const { return _done; }
+
+   private:
+
+      std::thread          _thread;
+      std::atomic<bool>    _done{true};
+   };
+
    ////////////////////////////////////////////////////////////////////////////
    // Inlines
    ////////////////////////////////////////////////////////////////////////////
@@ -322,6 +357,10 @@ namespace cycfi { namespace elements
 #endif
 
    std::vector<fs::path>& font_paths();
+
+   // The directory where the persistent font index is kept. Set it before
+   // the first font is created. An empty path disables the index.
+   fs::path& font_index_directory();
 }}
 
 #endif
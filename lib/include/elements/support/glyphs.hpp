@@ -14,6 +14,8 @@
 #include <vector>
 #include <stdexcept>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 namespace cycfi { namespace elements
 {
@@ -41,10 +43,30 @@ namespace cycfi { namespace elements
                            template <typename F>
       void                 for_each(F f);
 
+                           // The cluster at x, or the first cluster at or
+                           // after utf8. x, left and right are relative to
+                           // the start of the glyphs, as in for_each. utf8
+                           // is null if there is no such cluster. Rows made
+                           // by master_glyphs::break_lines do a binary search.
+      struct cluster_bounds
+      {
+         char const*       utf8;
+         float             left;
+         float             right;
+      };
+
+      cluster_bounds       cluster_at(float x);
+      cluster_bounds       cluster_from(char const* utf8);
+
       std::size_t          size() const      { return _last - _first; }
       char const*          begin() const     { return _first; }
       char const*          end() const       { return _last; }
 
+                           // Shift the utf8 range by offset bytes, e.g. when
+                           // the text buffer is reallocated or edited before
+                           // this range. The glyphs themselves are untouched.
+      void                 relocate(std::ptrdiff_t offset);
+
       struct font_metrics
       {
          float             ascent;
@@ -62,6 +84,20 @@ namespace cycfi { namespace elements
       using cluster = cairo_text_cluster_t;
       using cluster_flags = cairo_text_cluster_flags_t;
 
+      // Break opportunities and advances, one per cluster. master_glyphs
+      // computes these once per shaping, so that breaking lines at any
+      // width, and finding positions within the lines, do not have to go
+      // back to the font.
+      struct break_info
+      {
+         std::uint32_t     byte;          // Offset of the cluster from the master's _first
+         std::uint32_t     glyph;         // Index of the cluster's first glyph
+         float             left;          // Left edge of the cluster's first glyph
+         float             right;         // Right edge of the cluster's first glyph
+         bool              space;
+         bool              newline;
+      };
+
       char const*          _first;
       char const*          _last;
       scaled_font*         _scaled_font   = nullptr;
@@ -70,6 +106,7 @@ namespace cycfi { namespace elements
       cluster*             _clusters      = nullptr;
       int                  _cluster_count = 0;
       cluster_flags        _clusterflags;
+      break_info const*    _info          = nullptr;
    };
 
    ////////////////////////////////////////////////////////////////////////////
@@ -129,10 +166,16 @@ namespace cycfi { namespace elements
       void                 text(std::string const& str, point start = {0, 0});
 
    private:
+
+      friend class glyphs;
+
                            master_glyphs(master_glyphs const&) = delete;
       master_glyphs&       operator=(master_glyphs const& rhs) = delete;
 
       void                 build(point start = {0, 0});
+      void                 compute_breaks();
+
+      std::vector<break_info> _breaks;
    };
 
    ////////////////////////////////////////////////////////////////////////////
@@ -178,6 +221,12 @@ namespace cycfi { namespace elements
       text(str.data(), str.data() + str.size(), start);
    }
 
+   inline void glyphs::relocate(std::ptrdiff_t offset)
+   {
+      _first += offset;
+      _last += offset;
+   }
+
    template <typename F>
    inline void glyphs::for_each(F f)
    {
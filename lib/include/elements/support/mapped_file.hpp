@@ -0,0 +1,69 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_MAPPED_FILE_OCTOBER_19_2026)
+#define ELEMENTS_MAPPED_FILE_OCTOBER_19_2026
+
+#include <infra/filesystem.hpp>
+#include <infra/string_view.hpp>
+#include <cstddef>
+#include <stdexcept>
+
+namespace cycfi::elements
+{
+   struct failed_to_map_file : std::runtime_error
+   {
+      using std::runtime_error::runtime_error;
+   };
+
+   /**
+    * \class mapped_file
+    *
+    * \brief
+    *    A read-only memory mapping of a whole file.
+    *
+    *    The file's pages are loaded by the OS on demand, and shared with
+    *    the page cache and with any other mapping of the same file. The
+    *    mapping covers the file's size at the time it was opened; to see
+    *    what was appended to a growing file, map it again.
+    *
+    *    On POSIX systems, reading a mapping past the end of a file that was
+    *    truncated since it was mapped raises SIGBUS. Don't map files that
+    *    may shrink while mapped, such as logs being followed; read them
+    *    instead.
+    *
+    *    Throws `failed_to_map_file` if the file cannot be opened or mapped.
+    *    An empty file maps to an empty range.
+    */
+   class mapped_file
+   {
+   public:
+                              mapped_file() = default;
+      explicit                mapped_file(fs::path const& path);
+                              mapped_file(mapped_file const&) = delete;
+                              mapped_file(mapped_file&& rhs);
+                              ~mapped_file();
+
+      mapped_file&            operator=(mapped_file const&) = delete;
+      mapped_file&            operator=(mapped_file&& rhs);
+
+      char const*             data() const      { return static_cast<char const*>(_data); }
+      std::size_t             size() const      { return _size; }
+      bool                    empty() const     { return _size == 0; }
+      string_view             view() const      { return {data(), _size}; }
+
+      char const*             begin() const     { return data(); }
+      char const*             end() const       { return data() + _size; }
+
+   private:
+
+      void                    unmap();
+
+      void const*             _data = nullptr;
+      std::size_t             _size = 0;
+   };
+}
+
+#endif
@@ -12,6 +12,8 @@
 #include <elements/support/point.hpp>
 #include <infra/filesystem.hpp>
 #include <stdexcept>
+#include <cstddef>
+#include <cstdint>
 
 namespace cycfi { namespace elements
 {
@@ -25,12 +27,51 @@ namespace cycfi { namespace elements
       using std::runtime_error::runtime_error;
    };
 
+   /**
+    * \brief
+    *    How a pixmap loaded from a file holds its image.
+    *
+    *    `decoded` pixmaps are decoded when loaded, and keep their pixels.
+    *
+    *    `compressed` pixmaps keep the file's encoded bytes, and are decoded
+    *    when first drawn. Their pixels are freed again, least recently
+    *    drawn first, when all the compressed pixmaps' pixels go over the
+    *    budget set by `compressed_pixmap_budget`. This suits large images
+    *    that are rarely shown, such as those of inactive `deck_element`
+    *    pages or tabs. Compressed pixmaps must be drawn from the UI thread
+    *    only. Drawing into one (see `pixmap_context`) makes it `decoded`.
+    */
+   enum class pixmap_storage
+   {
+      decoded,
+      compressed
+   };
+
+   struct compressed_pixmap_statistics
+   {
+      std::size_t       pixmaps = 0;         // Compressed pixmaps alive
+      std::size_t       resident = 0;        // Of those, the ones decoded
+      std::size_t       resident_bytes = 0;  // Pixel memory of the decoded ones
+      std::size_t       encoded_bytes = 0;   // Encoded bytes of all of them
+      std::size_t       budget = 0;
+   };
+
+   compressed_pixmap_statistics  compressed_pixmap_stats();
+   void                          compressed_pixmap_budget(std::size_t bytes);
+
    class pixmap
    {
    public:
 
+      static constexpr std::size_t default_compressed_budget = 256 * 1024 * 1024;
+
       explicit          pixmap(point size, float scale = 1);
-      explicit          pixmap(fs::path const& path, float scale = 1);
+      explicit          pixmap(
+                           fs::path const& path
+                         , float scale = 1
+                         , pixmap_storage storage = pixmap_storage::decoded
+                        );
+                        pixmap(point size, std::uint8_t const* rgba, std::size_t stride, float scale = 1);
                         pixmap(pixmap const& rhs) = delete;
                         pixmap(pixmap&& rhs);
                         ~pixmap();
@@ -41,13 +82,33 @@ namespace cycfi { namespace elements
       extent            size() const;
       float             scale() const;
       void              scale(float val);
+      std::size_t       bytes() const;
+      std::size_t       encoded_bytes() const;
+      bool              is_compressed() const   { return _compressed != nullptr; }
+      bool              is_resident() const     { return _surface != nullptr; }
 
    private:
 
       friend class canvas;
       friend class pixmap_context;
-
-      cairo_surface_t*  _surface;
+      friend compressed_pixmap_statistics compressed_pixmap_stats();
+      friend void compressed_pixmap_budget(std::size_t bytes);
+
+      struct compressed_data;
+      using compressed_ptr = std::unique_ptr<compressed_data>;
+      using mipmaps = std::vector<cairo_surface_t*>;
+
+      cairo_surface_t*  surface() const;
+      cairo_surface_t*  mipmap(double ratio) const;
+      cairo_surface_t*  get_mipmap(double ratio) const;
+      void              clear_mipmaps() const;
+      void              touch() const;
+      void              evict() const;
+      void              decompress();
+
+      mutable cairo_surface_t* _surface;
+      mutable mipmaps   _mipmaps;      // Half size levels, built on demand
+      compressed_ptr    _compressed;   // Null unless compressed
    };
 
    using pixmap_ptr = std::shared_ptr<pixmap>;
@@ -61,6 +122,10 @@ namespace cycfi { namespace elements
 
       explicit          pixmap_context(pixmap& pm)
                         {
+                           // The mipmaps will be out of date, and so will
+                           // the encoded image, if any
+                           pm.decompress();
+                           pm.clear_mipmaps();
                            _context = cairo_create(pm._surface);
                         }
 
@@ -77,30 +142,13 @@ namespace cycfi { namespace elements
                         }
 
       cairo_t*          context() const { return _context; }
+      void              copy(pixmap const& src, point pos) const;
 
    private:
                         pixmap_context(pixmap_context const&) = delete;
 
       cairo_t*          _context;
    };
-
-   ////////////////////////////////////////////////////////////////////////////
-   // Inlines
-   ////////////////////////////////////////////////////////////////////////////
-   inline pixmap::pixmap(pixmap&& rhs)
-    : _surface(rhs._surface)
-   {
-      rhs._surface = nullptr;
-   }
-
-   inline pixmap& pixmap::operator=(pixmap&& rhs)
-   {
-      if (this != &rhs)
-      {
-        std::swap(_surface, rhs._surface);
-      }
-      return *this;
-   }
 }}
 
 #endif
@@ -0,0 +1,95 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_PIXMAP_CACHE_OCTOBER_19_2026)
+#define ELEMENTS_PIXMAP_CACHE_OCTOBER_19_2026
+
+#include <elements/support/pixmap.hpp>
+#include <infra/filesystem.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace cycfi::elements
+{
+   /**
+    * \class pixmap_cache
+    *
+    * \brief
+    *    A process-wide cache of pixmaps loaded from files, so that elements
+    *    showing the same image share one decoded surface.
+    *
+    *    Pixmaps are keyed by their resolved path (see `find_file`), scale
+    *    and file modification time. A file that changed on disk is loaded
+    *    again. The cache holds weak references only: a pixmap is freed
+    *    when the last element using it goes away. `trim` drops the entries
+    *    of pixmaps that are gone.
+    *
+    *    Cached pixmaps are shared. Do not draw into them or change their
+    *    scale; load a private copy with `std::make_shared<pixmap>` instead.
+    *
+    *    The cache is thread safe.
+    */
+   class pixmap_cache
+   {
+   public:
+
+      struct statistics
+      {
+         std::uint64_t        hits = 0;
+         std::uint64_t        misses = 0;
+         std::size_t          entries = 0;   // Pixmaps alive
+         std::size_t          bytes = 0;     // Pixel memory of the pixmaps alive
+      };
+
+                              pixmap_cache() = default;
+                              pixmap_cache(pixmap_cache const&) = delete;
+      pixmap_cache&           operator=(pixmap_cache const&) = delete;
+
+      pixmap_ptr              get(fs::path const& path, float scale = 1);
+      pixmap_ptr              find(fs::path const& path, float scale = 1);
+
+      statistics              stats() const;
+      void                    reset_stats();
+      std::size_t             trim();
+
+   private:
+
+      struct key
+      {
+         std::string          path;
+         float                scale;
+         std::int64_t         mtime;
+
+         bool                 operator<(key const& rhs) const;
+      };
+
+      using entry_map = std::map<key, std::weak_ptr<pixmap>>;
+
+      static bool             make_key(fs::path const& path, float scale, key& k);
+
+      mutable std::mutex      _mutex;
+      entry_map               _map;
+      std::uint64_t           _hits = 0;
+      std::uint64_t           _misses = 0;
+   };
+
+   pixmap_cache&              get_pixmap_cache();
+
+   /**
+    * \brief
+    *    Load the pixmap at `path` through the process-wide pixmap cache.
+    *    Throws `failed_to_load_pixmap` if the file can't be loaded.
+    */
+   inline pixmap_ptr load_pixmap(fs::path const& path, float scale = 1)
+   {
+      return get_pixmap_cache().get(path, scale);
+   }
+}
+
+#endif
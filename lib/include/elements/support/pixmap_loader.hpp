@@ -0,0 +1,83 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_PIXMAP_LOADER_OCTOBER_19_2026)
+#define ELEMENTS_PIXMAP_LOADER_OCTOBER_19_2026
+
+#include <elements/support/pixmap.hpp>
+#include <infra/filesystem.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace cycfi::elements
+{
+   /**
+    * \class pixmap_load
+    *
+    * \brief
+    *    A pending background pixmap load, started by `load_pixmap_async`.
+    *    Call `cancel` when the result is no longer wanted.
+    */
+   class pixmap_load
+   {
+   public:
+
+      using done_function = std::function<void(pixmap_ptr pm)>;
+
+                              pixmap_load(done_function done);
+
+      void                    cancel();
+      bool                    is_cancelled() const;
+
+   private:
+
+      friend class pixmap_loader;
+
+      void                    complete(pixmap_ptr pm);
+
+      mutable std::mutex      _mutex;
+      done_function           _done;
+   };
+
+   using pixmap_load_ptr = std::shared_ptr<pixmap_load>;
+
+   /**
+    * \brief
+    *    Load the pixmap at `path`, through the pixmap cache, on a pool of
+    *    worker threads. `done` is called on a worker thread with the
+    *    pixmap, or with null if it could not be loaded.
+    *
+    *    Once `cancel` returns, `done` will not be called, and is not
+    *    running. Loads cancelled before they start are skipped.
+    */
+   pixmap_load_ptr            load_pixmap_async(
+                                 fs::path path
+                               , float scale
+                               , pixmap_load::done_function done
+                              );
+
+   /**
+    * \brief
+    *    Make a pixmap with `make` on the image decoding worker pool, e.g. a
+    *    tile of a large image. `done` is called on a worker thread with
+    *    the pixmap, or with null if `make` throws `failed_to_load_pixmap`.
+    *    Cancelling works as with `load_pixmap_async`.
+    */
+   pixmap_load_ptr            make_pixmap_async(
+                                 std::function<pixmap_ptr()> make
+                               , pixmap_load::done_function done
+                              );
+
+   /**
+    * \brief
+    *    Run `f` on the image decoding worker pool, the same pool that
+    *    `load_pixmap_async` uses. For elements that decode images in other
+    *    ways, e.g. in tiles.
+    */
+   void                       post_decode_work(std::function<void()> f);
+}
+
+#endif
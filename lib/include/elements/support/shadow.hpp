@@ -0,0 +1,127 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_SHADOW_OCTOBER_19_2026)
+#define ELEMENTS_SHADOW_OCTOBER_19_2026
+
+#include <elements/support/canvas.hpp>
+#include <elements/support/color.hpp>
+#include <elements/support/pixmap.hpp>
+#include <elements/support/point.hpp>
+#include <elements/support/rect.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace cycfi::elements
+{
+   /**
+    * \class shadow_cache
+    *
+    * \brief
+    *    A process-wide cache of soft shadows of rounded rectangles.
+    *
+    *    Cairo has no blur. A shadow is rendered once, as a filled rounded
+    *    rectangle with a Gaussian blur, and kept as a pixmap keyed by its
+    *    size, blur radius, corner radius, color and resolution. Drawing it
+    *    again is a single blit.
+    *
+    *    As with CSS's `box-shadow`, the blur `radius` is twice the standard
+    *    deviation of the Gaussian. The pixmap extends `margin(radius)`
+    *    past the rectangle on each side.
+    *
+    *    The least recently used shadows are dropped when the cache goes
+    *    over `budget` bytes. The cache is thread safe.
+    */
+   class shadow_cache
+   {
+   public:
+
+      static constexpr std::size_t default_budget = 16 * 1024 * 1024;
+
+      struct statistics
+      {
+         std::uint64_t        hits = 0;
+         std::uint64_t        misses = 0;
+         std::size_t          entries = 0;
+         std::size_t          bytes = 0;
+      };
+
+                              shadow_cache() = default;
+                              shadow_cache(shadow_cache const&) = delete;
+      shadow_cache&           operator=(shadow_cache const&) = delete;
+
+      pixmap_ptr              get(
+                                 extent size
+                               , float radius
+                               , float corner_radius
+                               , color c
+                               , float resolution = 1
+                              );
+
+      static float            margin(float radius);
+
+      std::size_t             budget() const;
+      void                    budget(std::size_t bytes);
+      statistics              stats() const;
+      void                    reset_stats();
+
+   private:
+
+      struct key
+      {
+         float                width;
+         float                height;
+         float                radius;
+         float                corner_radius;
+         std::uint32_t        rgba;
+         float                resolution;
+
+         bool                 operator<(key const& rhs) const;
+      };
+
+      struct entry
+      {
+         key                  k;
+         pixmap_ptr           pixmap;
+         std::size_t          bytes;
+      };
+
+      using entry_list = std::list<entry>;
+      using entry_map = std::map<key, entry_list::iterator>;
+
+      static pixmap_ptr       render(key const& k);
+      void                    trim();
+
+      mutable std::mutex      _mutex;
+      entry_list              _entries;      // Most recently used first
+      entry_map               _map;
+      std::size_t             _budget = default_budget;
+      std::size_t             _bytes = 0;
+      std::uint64_t           _hits = 0;
+      std::uint64_t           _misses = 0;
+   };
+
+   shadow_cache&              get_shadow_cache();
+
+   /**
+    * \brief
+    *    Draw the soft shadow of a rounded rectangle, `bounds` moved by
+    *    `offset`, from the shadow cache. Draws it at the canvas's device
+    *    resolution.
+    */
+   void                       draw_shadow(
+                                 canvas& cnv
+                               , rect bounds
+                               , float radius
+                               , float corner_radius = 0
+                               , color c = colors::black.opacity(0.4)
+                               , point offset = {0, 0}
+                              );
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_SHAPED_TEXT_CACHE_OCTOBER_19_2026)
+#define ELEMENTS_SHAPED_TEXT_CACHE_OCTOBER_19_2026
+
+#include <infra/string_view.hpp>
+#include <cairo.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cycfi::elements
+{
+   /**
+    * \brief
+    *    A string shaped with a given scaled font: its glyphs, positioned
+    *    from the origin, and its extents.
+    */
+   struct shaped_text
+   {
+      std::vector<cairo_glyph_t> glyphs;
+      cairo_text_extents_t       extents;
+   };
+
+   using shaped_text_ptr = std::shared_ptr<shaped_text const>;
+
+   /**
+    * \class shaped_text_cache
+    *
+    * \brief
+    *    A process-wide LRU cache of shaped text, keyed by scaled font (the
+    *    font face, size and transform) and UTF-8 content.
+    *
+    *    The canvas text functions (`fill_text`, `stroke_text` and
+    *    `measure_text`) go through this cache, so labels and captions that
+    *    are measured and drawn over and over are shaped only once. The
+    *    least recently used entries are dropped when the cache goes over
+    *    its memory budget.
+    *
+    *    The cache is thread safe. The returned `shaped_text_ptr` stays
+    *    valid even if its entry is dropped.
+    */
+   class shaped_text_cache
+   {
+   public:
+
+      struct statistics
+      {
+         std::uint64_t        hits = 0;
+         std::uint64_t        misses = 0;
+         std::size_t          entries = 0;
+         std::size_t          bytes = 0;
+         std::size_t          budget = 0;
+
+         double               hit_rate() const;
+      };
+
+      static constexpr std::size_t default_budget = 4 * 1024 * 1024;
+
+                              shaped_text_cache(std::size_t budget = default_budget);
+                              shaped_text_cache(shaped_text_cache const&) = delete;
+                              ~shaped_text_cache();
+
+      shaped_text_cache&      operator=(shaped_text_cache const&) = delete;
+
+      shaped_text_ptr         get(cairo_scaled_font_t* font, string_view utf8);
+
+      std::size_t             budget() const;
+      void                    budget(std::size_t bytes);
+      statistics              stats() const;
+      void                    reset_stats();
+      void                    clear();
+
+   private:
+
+      struct entry;
+      struct key
+      {
+         cairo_scaled_font_t* font;
+         string_view          utf8;
+
+         bool                 operator==(key const& rhs) const;
+      };
+
+      struct key_hash
+      {
+         std::size_t          operator()(key const& k) const;
+      };
+
+      using entry_list = std::list<entry>;
+      using entry_map = std::unordered_map<key, entry_list::iterator, key_hash>;
+
+      void                    trim();
+      void                    drop_last();
+
+      mutable std::mutex      _mutex;
+      entry_list              _entries;      // Most recently used first
+      entry_map               _map;          // Keys point into _entries
+      std::size_t             _bytes = 0;
+      std::size_t             _budget;
+      std::uint64_t           _hits = 0;
+      std::uint64_t           _misses = 0;
+   };
+
+   shaped_text_cache&         get_shaped_text_cache();
+}
+
+#endif
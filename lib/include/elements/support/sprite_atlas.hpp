@@ -0,0 +1,121 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_SPRITE_ATLAS_OCTOBER_19_2026)
+#define ELEMENTS_SPRITE_ATLAS_OCTOBER_19_2026
+
+#include <elements/support/pixmap.hpp>
+#include <elements/support/rect.hpp>
+#include <infra/filesystem.hpp>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cycfi::elements
+{
+   /**
+    * \brief
+    *    Where a sprite is in an atlas: the atlas page, and the sprite's
+    *    bounds in the page's user space.
+    */
+   struct sprite_region
+   {
+      pixmap_ptr              pixmap;
+      rect                    bounds;
+   };
+
+   /**
+    * \class sprite_atlas
+    *
+    * \brief
+    *    Packs many sprite strips into a few shared pixmaps (pages), for
+    *    fewer surfaces and better cache locality than a pixmap per sprite.
+    *
+    *    Add the sprites, then `pack` them. Sprites are placed with a
+    *    skyline packer, tallest first, with `padding` pixels between them
+    *    so that filtering does not bleed across. A sprite larger than a
+    *    page gets a page of its own.
+    *
+    *    Pages drawn scaled down use the pixmap's mipmaps, whose level k
+    *    averages blocks of 2^k by 2^k pixels. So that such blocks never mix
+    *    two sprites, down to level `mip_levels` (1/4 scale by default),
+    *    the sprites' origins are aligned to 2^mip_levels pixels, and the
+    *    space between them is at least that wide. Sprites drawn smaller
+    *    than that may still bleed at their edges; raise `mip_levels` for
+    *    them, at the cost of more page space. More sprites may be added and packed
+    *    later; they fill the space left in the existing pages first.
+    *
+    *    The sprites' own pixmaps are released once packed. All sprites in
+    *    an atlas have the same scale. Use the regions with `basic_sprite`.
+    */
+   class sprite_atlas
+   {
+   public:
+
+      static constexpr int    default_page_size = 2048;
+      static constexpr int    default_mip_levels = 2;
+
+      struct statistics
+      {
+         std::size_t          sprites = 0;
+         std::size_t          pages = 0;
+         std::size_t          bytes = 0;        // Pixel memory of the pages
+         double               efficiency = 0;   // Fraction of the page area used
+      };
+
+      explicit                sprite_atlas(
+                                 float scale = 1
+                               , int page_size = default_page_size
+                               , int padding = 1
+                               , int mip_levels = default_mip_levels
+                              );
+
+      std::size_t             add(fs::path const& path);
+      std::size_t             add(pixmap_ptr pm);
+      void                    pack();
+
+      sprite_region const&    operator[](std::size_t i) const  { return _regions[i]; }
+      sprite_region const*    find(fs::path const& path) const;
+      std::size_t             size() const                     { return _regions.size(); }
+      statistics              stats() const;
+
+   private:
+
+      struct skyline_node
+      {
+         int                  x, y, width;
+      };
+
+      struct page
+      {
+         pixmap_ptr           pixmap;
+         int                  width, height;
+         std::vector<skyline_node> skyline;
+      };
+
+      struct pending
+      {
+         std::size_t          index;
+         pixmap_ptr           pixmap;
+         int                  width, height;    // Pixels
+      };
+
+      bool                    place(page& p, int w, int h, int& x, int& y);
+      page&                   new_page(int w, int h);
+
+      float                   _scale;
+      int                     _page_size;
+      int                     _padding;
+      int                     _align;           // Of the sprites' origins, in pixels
+      std::vector<page>       _pages;
+      std::vector<sprite_region> _regions;
+      std::vector<pending>    _pending;
+      std::map<std::string, std::size_t> _paths;
+      std::size_t             _used = 0;        // Pixels taken by sprites
+   };
+}
+
+#endif
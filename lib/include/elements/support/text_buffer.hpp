@@ -0,0 +1,193 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#if !defined(ELEMENTS_TEXT_BUFFER_OCTOBER_19_2026)
+#define ELEMENTS_TEXT_BUFFER_OCTOBER_19_2026
+
+#include <infra/string_view.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace cycfi::elements
+{
+   /**
+    * \class text_buffer
+    *
+    * \brief
+    *    A piece table for editing large texts.
+    *
+    *    The text is a sequence of pieces, each one a slice of an immutable
+    *    buffer: either the original text, or an append-only buffer that
+    *    holds the inserted text. The pieces are kept in a persistent
+    *    balanced tree (a treap) indexed by byte position, so insert, erase
+    *    and random access are O(log n) in the number of pieces, regardless
+    *    of the size of the text. Consecutive inserts at the same position
+    *    (e.g. typing) extend a single piece.
+    *
+    *    The tree is never modified in place; an edit creates only the
+    *    O(log n) nodes along the path it changes and shares the rest.
+    *    Copying a text_buffer is O(1) and the copy is an independent
+    *    snapshot, cheap enough to keep for undo or to hand over to another
+    *    thread for reading.
+    *
+    *    Use `for_each_piece` to iterate over the text without flattening
+    *    it into a single string. `text_view` displays a text_buffer that
+    *    way.
+    */
+   class text_buffer
+   {
+   public:
+                              text_buffer() = default;
+      explicit                text_buffer(string_view text);
+
+                              text_buffer(text_buffer const& rhs);
+                              text_buffer(text_buffer&& rhs) = default;
+      text_buffer&            operator=(text_buffer const& rhs);
+      text_buffer&            operator=(text_buffer&& rhs) = default;
+
+      std::size_t             size() const;
+      bool                    empty() const              { return size() == 0; }
+      char                    operator[](std::size_t pos) const;
+
+      void                    insert(std::size_t pos, string_view text);
+      void                    erase(std::size_t pos, std::size_t count);
+      void                    replace(std::size_t pos, std::size_t count, string_view text);
+      void                    clear();
+
+      std::string             substr(std::size_t pos, std::size_t count) const;
+      std::string             str() const;
+
+                              // for_each_piece F signature:
+                              // bool f(string_view piece);
+                              template <typename F>
+      void                    for_each_piece(std::size_t pos, std::size_t count, F&& f) const;
+                              template <typename F>
+      void                    for_each_piece(F&& f) const;
+
+   private:
+
+      struct chunk;
+      struct piece;
+      struct node;
+
+      using chunk_ptr = std::shared_ptr<chunk>;
+      using node_ptr = std::shared_ptr<node const>;
+      using node_pair = std::pair<node_ptr, node_ptr>;
+
+      static std::size_t      size_of(node_ptr const& n);
+      static node_ptr         make_node(node_ptr left, piece const& p, node_ptr right, std::uint32_t priority);
+      static node_ptr         make_leaf(piece const& p);
+      static node_ptr         merge(node_ptr const& a, node_ptr const& b);
+      static node_pair        split(node_ptr const& n, std::size_t pos);
+      static node_ptr         extend_last(node_ptr const& n, std::size_t length);
+      static piece const*     last_piece(node_ptr const& n);
+
+                              template <typename F>
+      static bool             visit(node const* n, std::size_t first, std::size_t last, F& f);
+
+      node_ptr                _root;
+      chunk_ptr               _add;    // Where inserted text goes; never shared between copies
+   };
+
+   /**
+    * \brief
+    *    A buffer of text. Its storage never moves, and bytes are only ever
+    *    appended to it, so the bytes referenced by existing pieces are
+    *    immutable.
+    */
+   struct text_buffer::chunk
+   {
+      explicit                chunk(std::size_t capacity_)
+                               : bytes{new char[capacity_]}
+                               , capacity{capacity_}
+                              {}
+
+      std::unique_ptr<char[]> bytes;
+      std::size_t             capacity;
+      std::size_t             used = 0;
+   };
+
+   struct text_buffer::piece
+   {
+      string_view             view() const { return {buffer->bytes.get() + offset, length}; }
+
+      std::shared_ptr<chunk const> buffer;
+      std::size_t             offset = 0;
+      std::size_t             length = 0;
+   };
+
+   struct text_buffer::node
+   {
+      node_ptr                left;
+      node_ptr                right;
+      piece                   p;
+      std::size_t             size;       // Total size of this subtree
+      std::uint32_t           priority;
+   };
+
+   //--------------------------------------------------------------------------
+   // Inlines
+   //--------------------------------------------------------------------------
+
+   inline std::size_t text_buffer::size_of(node_ptr const& n)
+   {
+      return n? n->size : 0;
+   }
+
+   inline std::size_t text_buffer::size() const
+   {
+      return size_of(_root);
+   }
+
+   template <typename F>
+   inline bool text_buffer::visit(node const* n, std::size_t first, std::size_t last, F& f)
+   {
+      // first and last are relative to the start of this subtree
+      if (!n || first >= last)
+         return true;
+
+      auto left_size = size_of(n->left);
+      if (first < left_size && !visit(n->left.get(), first, std::min(last, left_size), f))
+         return false;
+
+      auto piece_first = left_size;
+      auto piece_last = left_size + n->p.length;
+      if (first < piece_last && last > piece_first)
+      {
+         auto b = std::max(first, piece_first) - piece_first;
+         auto e = std::min(last, piece_last) - piece_first;
+         if (!f(n->p.view().substr(b, e - b)))
+            return false;
+      }
+
+      if (last > piece_last)
+         return visit(n->right.get(), std::max(first, piece_last) - piece_last, last - piece_last, f);
+      return true;
+   }
+
+   /**
+    * \brief
+    *    Call `f` for each piece of the text from `pos` to `pos + count`,
+    *    in order, until `f` returns false. O(log n + k), where k is the
+    *    number of pieces visited.
+    */
+   template <typename F>
+   inline void text_buffer::for_each_piece(std::size_t pos, std::size_t count, F&& f) const
+   {
+      auto last = pos + std::min(count, size() - std::min(pos, size()));
+      visit(_root.get(), pos, last, f);
+   }
+
+   template <typename F>
+   inline void text_buffer::for_each_piece(F&& f) const
+   {
+      visit(_root.get(), 0, size(), f);
+   }
+}
+
+#endif
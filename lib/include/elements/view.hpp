@@ -22,6 +22,7 @@
 #include <unordered_map>
 #include <chrono>
 #include <map>
+#include <deque>
 
 namespace cycfi::elements
 {
@@ -66,6 +67,7 @@ namespace cycfi::elements
       {
          std::function<void()> undo;
          std::function<void()> redo;
+         std::size_t           size = 0;   // Approximate memory held, in bytes
       };
 
       void                    add_undo(undo_redo_task t);
@@ -73,6 +75,8 @@ namespace cycfi::elements
       bool                    has_redo();
       bool                    undo();
       bool                    redo();
+      std::size_t             undo_budget() const;
+      void                    undo_budget(std::size_t bytes);
 
       using content_type = layer_composite;
       using layers_type = layer_composite::container_type;
@@ -140,9 +144,17 @@ namespace cycfi::elements
       mouse_button            _current_button;
       bool                    _is_focus = false;
 
-      using undo_stack_type = std::stack<undo_redo_task>;
+      void                    trim_undo();
+
+      static constexpr std::size_t default_undo_budget = 64 * 1024 * 1024;
+
+      // The newest tasks are at the back. The oldest undo tasks are dropped
+      // first when the undo and redo stacks exceed the budget.
+      using undo_stack_type = std::deque<undo_redo_task>;
       undo_stack_type         _undo_stack;
       undo_stack_type         _redo_stack;
+      std::size_t             _undo_size = 0;
+      std::size_t             _undo_budget = default_undo_budget;
 
       io_context              _io;
       asio::executor_work_guard<io_context::executor_type>        _work;
@@ -189,6 +201,20 @@ namespace cycfi::elements
       return !_redo_stack.empty();
    }
 
+   inline std::size_t view::undo_budget() const
+   {
+      return _undo_budget;
+   }
+
+   // Set the memory budget, in bytes, of the undo and redo stacks, as
+   // reported by each undo_redo_task::size. When the budget is exceeded,
+   // the oldest undo tasks are discarded. The most recent one is always kept.
+   inline void view::undo_budget(std::size_t bytes)
+   {
+      _undo_budget = bytes;
+      trim_undo();
+   }
+
    inline view::content_type& view::content()
    {
       return _content;
@@ -0,0 +1,23 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/app.hpp>
+#include <elements/support/theme.hpp>
+
+namespace cycfi::elements
+{
+   void app::warm_up_fonts()
+   {
+      auto const& thm = get_theme();
+      _font_warm_up.start(
+         {
+            thm.system_font
+          , thm.heading_font
+          , thm.label_font
+          , thm.icon_font
+         }
+      );
+   }
+}
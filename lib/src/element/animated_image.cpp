@@ -0,0 +1,407 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/element/animated_image.hpp>
+#include <elements/support/context.hpp>
+#include <elements/support/mapped_file.hpp>
+#include <elements/support/pixmap_loader.hpp>
+#include <elements/support/resource_paths.hpp>
+#include <elements/view.hpp>
+#include <webp/demux.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace cycfi::elements
+{
+   ////////////////////////////////////////////////////////////////////////////
+   // The frame decoder. It is shared by the element and the decoding task,
+   // if one is running, so that either may go away first. `fill` runs on a
+   // worker thread, one at a time; everything else runs on the UI thread.
+   ////////////////////////////////////////////////////////////////////////////
+   class animated_image::decoder
+   {
+   public:
+
+      struct frame
+      {
+         pixmap_ptr           pixmap;
+         int                  duration;      // Milliseconds
+      };
+
+                              decoder(fs::path const& path, std::size_t max_frames);
+                              decoder(decoder const&) = delete;
+                              ~decoder();
+
+      decoder&                operator=(decoder const&) = delete;
+
+      extent                  size() const;
+      std::size_t             num_frames() const   { return _info.frame_count; }
+
+      bool                    next(frame& f);
+      bool                    is_finished() const;
+      bool                    begin_fill();
+      void                    fill(float scale);
+      void                    cancel()             { _cancelled = true; }
+
+   private:
+
+      bool                    is_full() const;
+
+      mapped_file             _file;         // The decoder reads from the mapping
+      WebPAnimDecoder*        _dec = nullptr;
+      WebPAnimInfo            _info;
+      std::size_t             _max_frames;
+      bool                    _resident;     // The whole animation fits in the ring
+      int                     _timestamp = 0;
+      std::atomic<bool>       _cancelled{false};
+
+      mutable std::mutex      _mutex;        // Guards the members below
+      std::deque<frame>       _ready;        // Streaming: frames not yet shown
+      std::vector<frame>      _frames;       // Resident: all the frames
+      std::size_t             _index = 0;    // Resident: the next frame to show
+      std::size_t             _shown = 0;
+      bool                    _busy = false;
+      bool                    _complete = false;   // Nothing more to decode
+   };
+
+   animated_image::decoder::decoder(fs::path const& path, std::size_t max_frames)
+    : _max_frames{std::max<std::size_t>(max_frames, 2)}
+   {
+      fs::path full_path = find_file(path);
+      if (full_path.empty())
+         throw failed_to_load_pixmap{"File does not exist."};
+
+      try
+      {
+         _file = mapped_file{full_path};
+      }
+      catch (failed_to_map_file const&)
+      {
+         throw failed_to_load_pixmap{"Failed to open file: " + path.string()};
+      }
+
+      // Parsing the container is cheap. The frames are decoded later, on
+      // the worker pool.
+      WebPData data{reinterpret_cast<uint8_t const*>(_file.data()), _file.size()};
+      WebPAnimDecoderOptions options;
+      WebPAnimDecoderOptionsInit(&options);
+      options.color_mode = MODE_RGBA;
+      options.use_threads = 0;
+      _dec = WebPAnimDecoderNew(&data, &options);
+      if (!_dec || !WebPAnimDecoderGetInfo(_dec, &_info) || _info.frame_count == 0)
+      {
+         if (_dec)
+            WebPAnimDecoderDelete(_dec);
+         throw failed_to_load_pixmap{"Not a WebP image: " + path.string()};
+      }
+      _resident = _info.frame_count <= _max_frames;
+   }
+
+   animated_image::decoder::~decoder()
+   {
+      WebPAnimDecoderDelete(_dec);
+   }
+
+   extent animated_image::decoder::size() const
+   {
+      return {float(_info.canvas_width), float(_info.canvas_height)};
+   }
+
+   /**
+    * \brief
+    *    Get the next frame to show, if it has been decoded. Returns false
+    *    if it has not, or if the animation is finished.
+    */
+   bool animated_image::decoder::next(frame& f)
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+
+      // A loop count of zero means forever
+      if (_info.loop_count && _shown >= std::size_t(_info.loop_count) * _info.frame_count)
+         return false;
+
+      if (_resident)
+      {
+         if (_index == _frames.size())
+         {
+            if (!_complete || _frames.size() <= 1)
+               return false;
+            _index = 0;
+         }
+         f = _frames[_index++];
+      }
+      else
+      {
+         if (_ready.empty())
+            return false;
+         f = std::move(_ready.front());
+         _ready.pop_front();
+      }
+      ++_shown;
+      return true;
+   }
+
+   bool animated_image::decoder::is_finished() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (_info.loop_count && _shown >= std::size_t(_info.loop_count) * _info.frame_count)
+         return true;
+      if (_resident)   // Also true for a still image, once shown
+         return _complete && _frames.size() <= 1 && _index == _frames.size();
+      return _complete && _ready.empty();
+   }
+
+   bool animated_image::decoder::is_full() const
+   {
+      // Resident animations are decoded in one go. Streaming ones are
+      // topped up when the ring is half empty.
+      return _resident? false : _ready.size() > _max_frames / 2;
+   }
+
+   /**
+    * \brief
+    *    Returns true if the ring needs frames and no task is decoding them.
+    *    The caller must then run `fill`.
+    */
+   bool animated_image::decoder::begin_fill()
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (_busy || _complete || is_full())
+         return false;
+      _busy = true;
+      return true;
+   }
+
+   /**
+    * \brief
+    *    Decode frames until the ring is full. Runs on a worker thread.
+    */
+   void animated_image::decoder::fill(float scale)
+   {
+      auto capacity = _resident? std::size_t(_info.frame_count) : _max_frames;
+      auto w = int(_info.canvas_width);
+      auto h = int(_info.canvas_height);
+
+      while (!_cancelled)
+      {
+         {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if ((_resident? _frames.size() : _ready.size()) >= capacity)
+               break;
+         }
+
+         if (!WebPAnimDecoderHasMoreFrames(_dec))
+         {
+            if (_resident)
+            {
+               std::lock_guard<std::mutex> lock{_mutex};
+               _complete = true;
+               break;
+            }
+
+            // Streaming: start over for the next loop
+            WebPAnimDecoderReset(_dec);
+            _timestamp = 0;
+         }
+
+         // The decoder composites each frame onto the full canvas
+         uint8_t* buf = nullptr;
+         int timestamp = 0;
+         pixmap_ptr pm;
+         if (WebPAnimDecoderGetNext(_dec, &buf, &timestamp))
+         {
+            try
+            {
+               pm = std::make_shared<pixmap>(point{float(w), float(h)}, buf, std::size_t(w) * 4, scale);
+            }
+            catch (failed_to_load_pixmap const&)
+            {
+            }
+         }
+         if (!pm)
+         {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _complete = true;
+            break;
+         }
+
+         // Like browsers, treat very short frames as 100ms
+         auto duration = timestamp - _timestamp;
+         _timestamp = timestamp;
+         if (duration <= 10)
+            duration = 100;
+
+         std::lock_guard<std::mutex> lock{_mutex};
+         if (_resident)
+         {
+            _frames.push_back({std::move(pm), duration});
+            if (_frames.size() == capacity)
+               _complete = true;
+         }
+         else
+         {
+            _ready.push_back({std::move(pm), duration});
+         }
+      }
+
+      std::lock_guard<std::mutex> lock{_mutex};
+      _busy = false;
+   }
+
+   ////////////////////////////////////////////////////////////////////////////
+   // animated_image
+   ////////////////////////////////////////////////////////////////////////////
+   animated_image::animated_image(
+      fs::path path
+    , float scale
+    , std::size_t max_frames
+   )
+    : _path{std::move(path)}
+    , _scale{scale}
+    , _max_frames{max_frames}
+    , _decoder{std::make_shared<decoder>(_path, max_frames)}
+   {}
+
+   // Copies play on their own, from the first frame
+   animated_image::animated_image(animated_image const& rhs)
+    : element{rhs}
+    , _path{rhs._path}
+    , _scale{rhs._scale}
+    , _max_frames{rhs._max_frames}
+    , _decoder{std::make_shared<decoder>(_path, _max_frames)}
+    , _playing{rhs._playing}
+   {}
+
+   animated_image::animated_image(animated_image&& rhs)
+    : element{std::move(rhs)}
+    , _path{std::move(rhs._path)}
+    , _scale{rhs._scale}
+    , _max_frames{rhs._max_frames}
+    , _decoder{std::move(rhs._decoder)}
+    , _frame{std::move(rhs._frame)}
+    , _generation{rhs._generation}
+    , _playing{rhs._playing}
+    , _ticking{rhs._ticking}
+    , _awaiting_draw{rhs._awaiting_draw}
+    , _this_handle{std::move(rhs._this_handle)}
+   {
+      // The running clock comes with us
+      if (_this_handle)
+         *_this_handle = this;
+      rhs._ticking = false;
+   }
+
+   animated_image::~animated_image()
+   {
+      if (_decoder)
+         _decoder->cancel();
+   }
+
+   view_limits animated_image::limits(basic_context const& /* ctx */) const
+   {
+      auto size_ = _decoder->size();
+      size_ = {size_.x * _scale, size_.y * _scale};
+      return {{size_.x, size_.y}, {size_.x, size_.y}};
+   }
+
+   void animated_image::draw(context const& ctx)
+   {
+      if (_frame)
+         ctx.canvas.draw(*_frame, ctx.bounds);
+
+      _awaiting_draw = false;
+      if (_playing && !_ticking)
+         start(ctx.view);
+   }
+
+   /**
+    * \brief
+    *    Resume playback. It starts when the element is next drawn.
+    */
+   void animated_image::play()
+   {
+      _playing = true;
+   }
+
+   /**
+    * \brief
+    *    Stop playback, leaving the current frame on display.
+    */
+   void animated_image::stop()
+   {
+      _playing = false;
+      _ticking = false;
+      ++_generation;    // Stops the clock
+   }
+
+   std::size_t animated_image::num_frames() const
+   {
+      return _decoder->num_frames();
+   }
+
+   void animated_image::start(view& v)
+   {
+      if (!_this_handle)
+         _this_handle = std::make_shared<animated_image*>(this);
+
+      _ticking = true;
+      fill();
+      tick(v, ++_generation);
+   }
+
+   void animated_image::fill()
+   {
+      if (_decoder->begin_fill())
+         post_decode_work([d = _decoder, scale = _scale]() { d->fill(scale); });
+   }
+
+   /**
+    * \brief
+    *    Show the next frame, and schedule the one after it. If the last
+    *    frame shown was not drawn by now, we are hidden; pause until we
+    *    are drawn again.
+    */
+   void animated_image::tick(view& v, std::size_t generation)
+   {
+      if (generation != _generation)
+         return;
+
+      if (_awaiting_draw)
+      {
+         _ticking = false;
+         return;
+      }
+
+      auto delay = std::chrono::milliseconds{10};  // While waiting for the decoder
+      decoder::frame f;
+      if (_decoder->next(f))
+      {
+         _frame = std::move(f.pixmap);
+         _awaiting_draw = true;
+         v.refresh(*this);
+         delay = std::chrono::milliseconds{f.duration};
+      }
+      else if (_decoder->is_finished())
+      {
+         _playing = false;
+         _ticking = false;
+         return;
+      }
+      fill();
+
+      this_weak_handle wp = _this_handle;
+      v.post(delay,
+         [wp, &v, generation]()
+         {
+            if (auto p = wp.lock())
+               (*p)->tick(v, generation);
+         }
+      );
+   }
+}
@@ -0,0 +1,199 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/element/async_image.hpp>
+#include <elements/support/context.hpp>
+#include <elements/support/pixmap_cache.hpp>
+#include <elements/view.hpp>
+
+namespace cycfi::elements
+{
+   async_image::async_image(
+      fs::path path
+    , float scale
+    , pixmap_ptr placeholder
+   )
+    : _path{std::move(path)}
+    , _scale{scale}
+    , _pixmap{get_pixmap_cache().find(_path, scale)}
+    , _placeholder{placeholder}
+   {}
+
+   // Copies start their own load, when they are laid out
+   async_image::async_image(async_image const& rhs)
+    : element{rhs}
+    , _path{rhs._path}
+    , _scale{rhs._scale}
+    , _pixmap{rhs._pixmap}
+    , _placeholder{rhs._placeholder}
+    , _placeholder_color{rhs._placeholder_color}
+    , _failed{rhs._failed}
+   {}
+
+   async_image::async_image(async_image&& rhs)
+    : element{std::move(rhs)}
+    , _path{std::move(rhs._path)}
+    , _scale{rhs._scale}
+    , _pixmap{std::move(rhs._pixmap)}
+    , _placeholder{std::move(rhs._placeholder)}
+    , _placeholder_color{rhs._placeholder_color}
+    , _load{std::move(rhs._load)}
+    , _generation{rhs._generation}
+    , _failed{rhs._failed}
+    , _this_handle{std::move(rhs._this_handle)}
+   {
+      // The load in progress, if any, comes with us
+      if (_this_handle)
+         *_this_handle = this;
+   }
+
+   async_image::~async_image()
+   {
+      cancel_load();
+   }
+
+   async_image& async_image::operator=(async_image const& rhs)
+   {
+      if (this != &rhs)
+      {
+         cancel_load();
+         element::operator=(rhs);
+         _path = rhs._path;
+         _scale = rhs._scale;
+         _pixmap = rhs._pixmap;
+         _placeholder = rhs._placeholder;
+         _placeholder_color = rhs._placeholder_color;
+         _failed = rhs._failed;
+      }
+      return *this;
+   }
+
+   async_image& async_image::operator=(async_image&& rhs)
+   {
+      if (this != &rhs)
+      {
+         cancel_load();
+         element::operator=(std::move(rhs));
+         _path = std::move(rhs._path);
+         _scale = rhs._scale;
+         _pixmap = std::move(rhs._pixmap);
+         _placeholder = std::move(rhs._placeholder);
+         _placeholder_color = rhs._placeholder_color;
+         _load = std::move(rhs._load);
+         _generation = rhs._generation;
+         _failed = rhs._failed;
+         _this_handle = std::move(rhs._this_handle);
+         if (_this_handle)
+            *_this_handle = this;
+      }
+      return *this;
+   }
+
+   view_limits async_image::limits(basic_context const& /* ctx */) const
+   {
+      if (auto const& pm = _pixmap? _pixmap : _placeholder)
+      {
+         auto size_ = pm->size();
+         return {{size_.x, size_.y}, {size_.x, size_.y}};
+      }
+      return {{0, 0}, {full_extent, full_extent}};
+   }
+
+   void async_image::layout(context const& ctx)
+   {
+      start_load(ctx.view);
+   }
+
+   void async_image::draw(context const& ctx)
+   {
+      if (_pixmap)
+      {
+         ctx.canvas.draw(*_pixmap, ctx.bounds);
+         return;
+      }
+
+      start_load(ctx.view);
+      if (_placeholder)
+      {
+         ctx.canvas.draw(*_placeholder, ctx.bounds);
+      }
+      else
+      {
+         ctx.canvas.fill_style(_placeholder_color);
+         ctx.canvas.fill_rect(ctx.bounds);
+      }
+   }
+
+   /**
+    * \brief
+    *    Set the image to load. The load starts when the element is laid
+    *    out or drawn again. If the image is already in the pixmap cache,
+    *    it is shown right away.
+    */
+   void async_image::set_image(fs::path path, float scale)
+   {
+      cancel_load();
+      _path = std::move(path);
+      _scale = scale;
+      _pixmap = get_pixmap_cache().find(_path, scale);
+      _failed = false;
+   }
+
+   void async_image::start_load(view& v)
+   {
+      if (_pixmap || _load || _failed || _path.empty())
+         return;
+
+      if (!_this_handle)
+         _this_handle = std::make_shared<async_image*>(this);
+
+      this_weak_handle wp = _this_handle;
+      auto generation = ++_generation;
+      _load = load_pixmap_async(_path, _scale,
+         [wp, &v, generation](pixmap_ptr pm)
+         {
+            // We're on a worker thread. Hand the pixmap to the UI thread.
+            v.post(
+               [wp, &v, generation, pm]()
+               {
+                  if (auto p = wp.lock())
+                     (*p)->loaded(v, generation, pm);
+               }
+            );
+         }
+      );
+   }
+
+   void async_image::cancel_load()
+   {
+      if (_load)
+      {
+         _load->cancel();
+         _load.reset();
+      }
+   }
+
+   void async_image::loaded(view& v, std::size_t generation, pixmap_ptr pm)
+   {
+      // Ignore a stale result posted just before its load was cancelled
+      if (generation != _generation || !_load)
+         return;
+      _load.reset();
+
+      if (!pm)
+      {
+         _failed = true;
+         v.refresh(*this);
+         return;
+      }
+
+      bool resized = !_placeholder || _placeholder->size() != pm->size();
+      _pixmap = pm;
+      if (resized)
+         v.layout(*this);
+      else
+         v.refresh(*this);
+   }
+}
@@ -214,16 +214,23 @@ namespace cycfi::elements
    {
       if (_insertion_pos >= 0)
       {
+         auto ranges = to_ranges(indices);
          if (auto* c = find_subject<list*>(&subject()))
-            c->move(_insertion_pos, indices);
+            c->move(_insertion_pos, ranges);
          on_move(_insertion_pos, indices);
          if (auto s = find_subject<selection_list_element*>(this))
          {
-            for (int i : indices)
+            // The moved block starts at the insertion position, less the
+            // number of moved items that were before it.
+            std::size_t pos = _insertion_pos;
+            std::size_t before = 0;
+            for (auto const& r : ranges)
             {
-               if (i <= _insertion_pos)
-                  --_insertion_pos;
+               if (r.first >= pos)
+                  break;
+               before += std::min(r.last, pos) - r.first;
             }
+            _insertion_pos = pos - before;
             s->update_selection(_insertion_pos, _insertion_pos+indices.size()-1);
          }
       }
@@ -233,7 +240,7 @@ namespace cycfi::elements
    {
       if (auto* c = find_subject<list*>(&subject()))
       {
-         c->erase(indices);
+         c->erase(to_ranges(indices));
          on_erase(indices);
          if (auto s = find_subject<selection_list_element*>(this))
             s->select_none();
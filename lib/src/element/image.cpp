@@ -6,6 +6,7 @@
 #include <elements/element/image.hpp>
 #include <elements/support.hpp>
 #include <elements/support/context.hpp>
+#include <elements/support/pixmap_cache.hpp>
 #include <algorithm>
 
 namespace cycfi::elements
@@ -14,14 +15,14 @@ namespace cycfi::elements
    // image implementation
    ////////////////////////////////////////////////////////////////////////////
    image::image(fs::path const& path, float scale)
-    : _pixmap(std::make_shared<elements::pixmap>(path, scale))
+    : _pixmap(load_pixmap(path, scale))
    {
       if (!_pixmap)
          throw std::runtime_error{"Error: Invalid image."};
    }
 
    image::image(fs::path const& path, fit_enum)
-    : _pixmap(std::make_shared<elements::pixmap>(path, 1.0f))
+    : _pixmap(load_pixmap(path, 1.0f))
     , _fit{true}
    {
       if (!_pixmap)
@@ -89,7 +90,7 @@ namespace cycfi::elements
 
    void image::set_image(fs::path const& path, float scale)
    {
-      _pixmap = std::make_shared<elements::pixmap>(path, scale);
+      _pixmap = load_pixmap(path, scale);
       if (!_pixmap)
          throw std::runtime_error{"Error: Invalid image."};
    }
@@ -237,15 +238,29 @@ namespace cycfi::elements
     , _height(height)
    {}
 
+   basic_sprite::basic_sprite(sprite_region const& region, float height)
+    : image(region.pixmap)
+    , _index(0)
+    , _height(height)
+    , _region(region.bounds)
+   {}
+
+   rect basic_sprite::region() const
+   {
+      if (_region.is_empty())
+         return {{0, 0}, pixmap().size()};
+      return _region;
+   }
+
    view_limits basic_sprite::limits(basic_context const& /* ctx */) const
    {
-      auto width = pixmap().size().x;
+      auto width = region().width();
       return {{width, _height}, {width, _height}};
    }
 
    std::size_t basic_sprite::num_frames() const
    {
-      return pixmap().size().y / _height;
+      return region().height() / _height;
    }
 
    void basic_sprite::index(std::size_t index_)
@@ -256,12 +271,13 @@ namespace cycfi::elements
 
    point basic_sprite::size() const
    {
-      return {pixmap().size().x, _height};
+      return {region().width(), _height};
    }
 
    rect basic_sprite::source_rect(context const& /* ctx */) const
    {
-      auto width = pixmap().size().x;
-      return rect{0, _height * _index, width, _height * (_index + 1)};
+      auto r = region();
+      auto top = r.top + (_height * _index);
+      return rect{r.left, top, r.right, top + _height};
    }
 }
@@ -9,6 +9,42 @@
 
 namespace cycfi::elements
 {
+   /**
+    * \brief
+    *    Compress sorted indices into sorted, non-overlapping ranges of
+    *    consecutive indices.
+    *
+    * \param indices
+    *    Sorted indices. Duplicates are allowed.
+    *
+    * @return
+    *    The index ranges.
+    */
+   index_ranges to_ranges(std::vector<std::size_t> const& indices)
+   {
+      index_ranges ranges;
+      for (auto i : indices)
+      {
+         if (!ranges.empty() && i <= ranges.back().last)
+            ranges.back().last = std::max(ranges.back().last, i+1);
+         else
+            ranges.push_back({i, i+1});
+      }
+      return ranges;
+   }
+
+   /**
+    * \brief
+    *    Count the number of indices in the given ranges.
+    */
+   std::size_t count_indices(index_ranges const& ranges)
+   {
+      std::size_t n = 0;
+      for (auto const& r : ranges)
+         n += r.size();
+      return n;
+   }
+
    list::list(composer_ptr composer, bool manage_externally)
     : _composer(composer)
     , _manage_externally(manage_externally)
@@ -16,6 +52,9 @@ namespace cycfi::elements
     , _move_request{false}
     , _insert_request{false}
     , _erase_request{false}
+    , _remap_request{false}
+    , _relinquish_focus_request{false}
+    , _refocus_request{false}
    {}
 
    list::list(list const& rhs)
@@ -31,6 +70,9 @@ namespace cycfi::elements
     , _move_request{false}
     , _insert_request{false}
     , _erase_request{false}
+    , _remap_request{false}
+    , _relinquish_focus_request{false}
+    , _refocus_request{false}
     , _request_info{nullptr}
    {}
 
@@ -47,7 +89,9 @@ namespace cycfi::elements
     , _move_request{false}
     , _insert_request{false}
     , _erase_request{false}
+    , _remap_request{false}
     , _relinquish_focus_request{false}
+    , _refocus_request{false}
     , _request_info{nullptr}
    {}
 
@@ -67,7 +111,9 @@ namespace cycfi::elements
          _move_request = false;
          _insert_request = false;
          _erase_request = false;
+         _remap_request = false;
          _relinquish_focus_request = false;
+         _refocus_request = false;
          _request_info.reset();
       }
       return *this;
@@ -89,7 +135,9 @@ namespace cycfi::elements
          _move_request = false;
          _insert_request = false;
          _erase_request = false;
+         _remap_request = false;
          _relinquish_focus_request = false;
+         _refocus_request = false;
          _request_info.reset();
       }
       return *this;
@@ -126,6 +174,15 @@ namespace cycfi::elements
          relinquish_focus(*this, ctx);
          _relinquish_focus_request = false;
       }
+      if (_refocus_request)
+      {
+         // The cells were rearranged. Drop the stale tracking state, and
+         // follow the focused cell to its new index.
+         composite_base::reset();
+         if (_refocus_index != -1)
+            focus(_refocus_index);
+         _refocus_request = false;
+      }
 
       auto& cnv = ctx.canvas;
       auto  state = cnv.new_state();
@@ -314,18 +371,30 @@ namespace cycfi::elements
 
    void list::resize(size_t n)
    {
+      // A filtered and sorted view keeps the cells of the items that are
+      // still shown
+      if (auto fsc = std::dynamic_pointer_cast<filtered_sorted_composer>(_composer))
+      {
+         remap(fsc->resize_source(n));
+         return;
+      }
       this->_composer->resize(n);
       this->update();
    }
 
    void list::move(std::size_t pos, indices_type const& indices)
+   {
+      move(pos, to_ranges(indices));
+   }
+
+   void list::move(std::size_t pos, index_ranges const& ranges)
    {
       _move_request = true;
       if (!_request_info)
          _request_info = std::make_unique<request_info>();
       _request_info->_move_pos = pos;
-      _request_info->_move_indices = indices;
-}
+      _request_info->_move_ranges = ranges;
+   }
 
    void list::insert(std::size_t pos, std::size_t num_items)
    {
@@ -337,18 +406,44 @@ namespace cycfi::elements
    }
 
    void list::erase(indices_type const& indices)
+   {
+      erase(to_ranges(indices));
+   }
+
+   void list::erase(index_ranges const& ranges)
    {
       _erase_request = true;
       if (!_request_info)
          _request_info = std::make_unique<request_info>();
-      _request_info->_delete_indices = indices;
+      _request_info->_delete_ranges = ranges;
+   }
+
+   /**
+    * \brief
+    *    Rearrange the list cells, preserving the cells (and the composed
+    *    elements) of items that are still present.
+    *
+    *    The composer is expected to already reflect the new arrangement
+    *    (e.g. `filtered_sorted_composer`). The size of `from` must be equal
+    *    to the composer's size.
+    *
+    * \param from
+    *    For each new cell index, the old index of the cell to reuse, or
+    *    `list::npos` for a new cell.
+    */
+   void list::remap(indices_type const& from)
+   {
+      _remap_request = true;
+      if (!_request_info)
+         _request_info = std::make_unique<request_info>();
+      _request_info->_remap_from = from;
    }
 
    void list::move(basic_context const& ctx) const
    {
-      auto const& _move_indices = _request_info->_move_indices;
+      auto const& _move_ranges = _request_info->_move_ranges;
       auto _move_pos = _request_info->_move_pos;
-      move_indices(_cells, _move_pos, _move_indices);
+      move_ranges(_cells, _move_pos, _move_ranges);
 
       double y = 0;
       auto size = _composer->size();
@@ -389,9 +484,9 @@ namespace cycfi::elements
 
    void list::erase(basic_context const& ctx) const
    {
-      auto const& _delete_indices = _request_info->_delete_indices;
-      this->_composer->resize(this->_composer->size() - _delete_indices.size());
-      erase_indices(_cells, _delete_indices);
+      auto const& _delete_ranges = _request_info->_delete_ranges;
+      this->_composer->resize(this->_composer->size() - count_indices(_delete_ranges));
+      erase_ranges(_cells, _delete_ranges);
 
       double y = 0;
       auto size = _composer->size();
@@ -411,6 +506,48 @@ namespace cycfi::elements
       _erase_request = false;
    }
 
+   void list::remap(basic_context const& ctx) const
+   {
+      auto const& from = _request_info->_remap_from;
+      auto focus = focus_index();
+      int new_focus = -1;
+
+      cells_vector cells;
+      cells.reserve(from.size());
+      for (auto i : from)
+      {
+         if (i < _cells.size())
+         {
+            if (int(i) == focus)
+               new_focus = int(cells.size());
+            cells.push_back(std::move(_cells[i]));
+         }
+         else
+         {
+            cells.push_back(cell_info{});
+         }
+      }
+      _cells = std::move(cells);
+      if (focus != -1 && new_focus == -1)
+         _relinquish_focus_request = true;
+      _refocus_index = new_focus;
+      _refocus_request = true;
+
+      double y = 0;
+      auto size = std::min(_composer->size(), _cells.size());
+      for (std::size_t i = 0; i != size; ++i)
+      {
+         auto main_axis_size = _composer->main_axis_size(i, ctx);
+         _cells[i].pos = y;
+         _cells[i].main_axis_size = main_axis_size;
+         y += main_axis_size;
+      }
+      _main_axis_full_size = y;
+
+      ++_layout_id;
+      _remap_request = false;
+   }
+
    void list::sync(basic_context const& ctx) const
    {
       if (_update_request)
@@ -423,6 +560,8 @@ namespace cycfi::elements
             insert(ctx);
          if (_erase_request)
             erase(ctx);
+         if (_remap_request)
+            remap(ctx);
       }
       _request_info.reset();
    }
@@ -496,6 +635,192 @@ namespace cycfi::elements
       return r;
    }
 
-}
+   ////////////////////////////////////////////////////////////////////////////
+   // filtered_sorted_composer
+   ////////////////////////////////////////////////////////////////////////////
+   filtered_sorted_composer::filtered_sorted_composer(composer_ptr source)
+    : _source{std::move(source)}
+   {
+      _map = build();
+      _source_size = _source->size();
+   }
 
+   std::size_t filtered_sorted_composer::size() const
+   {
+      return _map.size();
+   }
 
+   // Use list::resize, which passes the remap to list::remap
+   void filtered_sorted_composer::resize(size_t s)
+   {
+      resize_source(s);
+   }
+
+   /**
+    * \brief
+    *    Resize the source, and rebuild the mapping.
+    *
+    * @return
+    *    The remap vector to pass to `list::remap`.
+    */
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::resize_source(std::size_t s)
+   {
+      _source->resize(s);
+      return refresh();
+   }
+
+   element_ptr filtered_sorted_composer::compose(std::size_t index)
+   {
+      return _source->compose(_map[index]);
+   }
+
+   cell_composer::limits
+   filtered_sorted_composer::secondary_axis_limits(basic_context const& ctx) const
+   {
+      return _source->secondary_axis_limits(ctx);
+   }
+
+   float filtered_sorted_composer::main_axis_size(std::size_t index, basic_context const& ctx) const
+   {
+      return _source->main_axis_size(_map[index], ctx);
+   }
+
+   /**
+    * \brief
+    *    Set the filter predicate.
+    *
+    * \param pred
+    *    The predicate, given a source index. Items for which `pred` returns
+    *    `false` are hidden. An empty function shows all items.
+    *
+    * \param refine
+    *    Set to `true` if the new predicate only ever rejects more items than
+    *    the previous one (e.g. while the user types a search query). Only
+    *    the currently visible items are then tested, and the current order
+    *    is kept without sorting again.
+    *
+    * @return
+    *    The remap vector to pass to `list::remap`.
+    */
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::filter(predicate_function pred, bool refine)
+   {
+      _pred = std::move(pred);
+      if (refine && _pred && _source_size == _source->size())
+      {
+         indices_type map;
+         map.reserve(_map.size());
+         std::copy_if(_map.begin(), _map.end(), std::back_inserter(map), _pred);
+         return commit(std::move(map));
+      }
+      return refresh();
+   }
+
+   /**
+    * \brief
+    *    Set the sort order, replacing the previous one.
+    *
+    *    The sort is stable: items that compare equal keep their source
+    *    order. Only one comparator is kept, and `refresh` sorts with it
+    *    alone. For a multi-key sort, pass a comparator that compares the
+    *    keys in turn.
+    *
+    * \param comp
+    *    A strict weak ordering, given two source indices. An empty function
+    *    restores the source order.
+    *
+    * @return
+    *    The remap vector to pass to `list::remap`.
+    */
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::sort(compare_function comp)
+   {
+      _comp = std::move(comp);
+      if (!_comp)
+         return refresh();
+
+      // Start from the source order, as build does, so that ties do not
+      // depend on the previous sort order
+      indices_type map = _map;
+      std::sort(map.begin(), map.end());
+      sort_map(map);
+      return commit(std::move(map));
+   }
+
+   /**
+    * \brief
+    *    Rebuild the mapping from the source, applying the current filter
+    *    and sort order. Call this when the source's items change.
+    *
+    * @return
+    *    The remap vector to pass to `list::remap`.
+    */
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::refresh()
+   {
+      return commit(build());
+   }
+
+   /**
+    * \brief
+    *    Remove the filter and the sort order.
+    *
+    * @return
+    *    The remap vector to pass to `list::remap`.
+    */
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::reset()
+   {
+      _pred = nullptr;
+      _comp = nullptr;
+      return refresh();
+   }
+
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::build() const
+   {
+      auto n = _source->size();
+      indices_type map;
+      map.reserve(n);
+      for (std::size_t i = 0; i != n; ++i)
+      {
+         if (!_pred || _pred(i))
+            map.push_back(i);
+      }
+      sort_map(map);
+      return map;
+   }
+
+   void filtered_sorted_composer::sort_map(indices_type& map) const
+   {
+      if (_comp)
+         std::stable_sort(map.begin(), map.end(), _comp);
+   }
+
+   filtered_sorted_composer::indices_type
+   filtered_sorted_composer::commit(indices_type map)
+   {
+      // Pair the old view indices with their source indices, by source
+      // index, so we can tell, for each new view index, where its cell used
+      // to be. This is O(n log n) in the number of items shown, not in the
+      // size of the source.
+      std::vector<std::pair<std::size_t, std::size_t>> where(_map.size());
+      for (std::size_t i = 0; i != _map.size(); ++i)
+         where[i] = {_map[i], i};
+      std::sort(where.begin(), where.end());
+
+      indices_type from(map.size(), list::npos);
+      for (std::size_t i = 0; i != map.size(); ++i)
+      {
+         auto j = std::lower_bound(
+            where.begin(), where.end(), std::make_pair(map[i], std::size_t(0)));
+         if (j != where.end() && j->first == map[i])
+            from[i] = j->second;
+      }
+
+      _map = std::move(map);
+      _source_size = _source->size();
+      return from;
+   }
+}
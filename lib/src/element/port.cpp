@@ -6,6 +6,7 @@
 #include <elements/element/port.hpp>
 #include <elements/element/traversal.hpp>
 #include <elements/view.hpp>
+#include <elements/support/pixmap.hpp>
 #include <algorithm>
 #include <cmath>
 
@@ -273,32 +274,46 @@ namespace cycfi::elements
       return view_limits{{min_x, min_y}, {max_x, max_y}};
    }
 
+   /**
+    * @brief
+    *    Get how far the subject is shifted, up and to the left, given the
+    *    current alignment. With `blit_scroll`, the offset is snapped to
+    *    whole pixels.
+    */
+   point scroller_base::scroll_offset(view_limits const& e_limits, rect const& bounds) const
+   {
+      point offset;
+      if (allow_hscroll() && e_limits.min.x > bounds.width())
+         offset.x = (e_limits.min.x - bounds.width()) * halign();
+      if (allow_vscroll() && e_limits.min.y > bounds.height())
+         offset.y = (e_limits.min.y - bounds.height()) * valign();
+      if (is_blit())
+         offset = {std::round(offset.x), std::round(offset.y)};
+      return offset;
+   }
+
    void scroller_base::prepare_subject(context& ctx)
    {
       view_limits e_limits = subject().limits(ctx);
+      rect const& bounds = ctx.parent->bounds;
+
+      if (allow_vscroll() && e_limits.min.y <= bounds.height())
+         valign(0.0);
+      if (allow_hscroll() && e_limits.min.x <= bounds.width())
+         halign(0.0);
+
+      point offset = scroll_offset(e_limits, bounds);
 
       if (allow_vscroll())
       {
-         double elem_height = e_limits.min.y;
-         double available_height = ctx.parent->bounds.height();
-
-         if (elem_height <= available_height)
-            valign(0.0);
-         else
-            ctx.bounds.top -= (elem_height - available_height) * valign();
-         ctx.bounds.height(elem_height);
+         ctx.bounds.top -= offset.y;
+         ctx.bounds.height(e_limits.min.y);
       }
 
       if (allow_hscroll())
       {
-         double elem_width = e_limits.min.x;
-         double available_width = ctx.parent->bounds.width();
-
-         if (elem_width <= available_width)
-            halign(0.0);
-         else
-            ctx.bounds.left -= (elem_width - available_width) * halign();
-         ctx.bounds.width(elem_width);
+         ctx.bounds.left -= offset.x;
+         ctx.bounds.width(e_limits.min.x);
       }
       subject().layout(ctx);
    }
@@ -354,9 +369,190 @@ namespace cycfi::elements
       return r;
    }
 
+   /**
+    * @brief
+    *    The backing pixmap of a `blit_scroll` scroller. We keep two
+    *    pixmaps and flip between them: a blit copies the front pixmap into
+    *    the back pixmap, shifted by the scroll delta, then the two are
+    *    swapped.
+    */
+   struct scroller_base::backing_store
+   {
+      explicit             backing_store(scroller_base const* owner_)
+                            : owner{owner_}
+                           {}
+
+      scroller_base const* owner;         // Copies of the scroller do not share the backing
+      pixmap_ptr           front;
+      pixmap_ptr           back;
+      rect                 bounds;        // Device bounds of the scroller
+      float                scale = 0;     // Device pixels per unit
+      point                offset;        // The scroll offset of the rendered content
+      point                content_size;
+   };
+
+   namespace
+   {
+      bool is_pixel_aligned(float val, float scale)
+      {
+         auto px = val * scale;
+         return std::abs(px - std::round(px)) < 0.01f;
+      }
+   }
+
+   /**
+    * @brief
+    *    Discard the scroller's backing pixmap, with the `blit_scroll`
+    *    trait, forcing the next draw to redraw the whole subject.
+    *
+    *    Refreshes that happen while the scroll position does not change
+    *    are taken care of automatically. Call this if the content changes
+    *    at the same time the scroller is scrolling without going through
+    *    the scroller's events (e.g. a log view that is appended to while
+    *    it is scrolled).
+    */
+   void scroller_base::invalidate()
+   {
+      _content_dirty = true;
+   }
+
+   /**
+    * @brief
+    *    Draw the subject, given `area` (user coordinates), into the
+    *    backing pixmap. The offscreen canvas maps user coordinates to device
+    *    coordinates exactly like the view's canvas does, so elements that
+    *    convert to device coordinates (e.g. for refreshing) still work.
+    */
+   void scroller_base::render_backing(context const& ctx, rect area)
+   {
+      auto& b = *_backing;
+      pixmap_context pm_ctx{*b.front};
+      auto& cr = *pm_ctx.context();
+
+      // The initial transform maps device coordinates to the backing
+      // pixmap. The canvas takes note of it.
+      cairo_translate(&cr, -b.bounds.left, -b.bounds.top);
+      canvas cnv{cr};
+      cnv.translate({b.bounds.left - ctx.bounds.left, b.bounds.top - ctx.bounds.top});
+
+      cnv.add_rect(area);
+      cnv.clip();
+      cairo_set_operator(&cr, CAIRO_OPERATOR_CLEAR);
+      cairo_paint(&cr);
+      cairo_set_operator(&cr, CAIRO_OPERATOR_OVER);
+
+      context octx{ctx.view, cnv, ctx.element, ctx.bounds};
+      octx.parent = ctx.parent;
+      octx.enabled = ctx.enabled;
+      port_element::draw(octx);
+   }
+
+   /**
+    * @brief
+    *    Draw through the backing pixmap. Returns false if the canvas
+    *    transform does not allow blitting (anything other than a pixel
+    *    aligned translation), in which case we simply draw the subject.
+    */
+   bool scroller_base::draw_blit(context const& ctx)
+   {
+      auto& cnv = ctx.canvas;
+      auto& cr = cnv.cairo_context();
+
+      auto tl = cnv.user_to_device(ctx.bounds.top_left());
+      auto br = cnv.user_to_device(ctx.bounds.bottom_right());
+      rect dev = {tl.x, tl.y, br.x, br.y};
+
+      double sx = 1, sy = 1;
+      cairo_surface_get_device_scale(cairo_get_target(&cr), &sx, &sy);
+      double ux = 1, uy = 0;
+      cairo_user_to_device_distance(&cr, &ux, &uy);
+      auto scale = float(ux * sx);
+
+      if (std::abs(dev.width() - ctx.bounds.width()) > 0.01f
+         || std::abs(dev.height() - ctx.bounds.height()) > 0.01f
+         || uy != 0 || sx != sy || dev.width() < 1 || dev.height() < 1
+         || !is_pixel_aligned(dev.left, scale) || !is_pixel_aligned(dev.top, scale))
+      {
+         return false;
+      }
+
+      if (!_backing || _backing->owner != this)
+         _backing = std::make_shared<backing_store>(this);
+      auto& b = *_backing;
+
+      view_limits e_limits = subject().limits(ctx);
+      point content_size = {e_limits.min.x, e_limits.min.y};
+      point offset = scroll_offset(e_limits, ctx.bounds);
+      bool full = _content_dirty || content_size != b.content_size || dev != b.bounds;
+
+      if (!b.front || dev.size() != b.bounds.size() || scale != b.scale)
+      {
+         point px_size = {std::ceil(dev.width() * scale), std::ceil(dev.height() * scale)};
+         b.front = std::make_shared<pixmap>(px_size, 1 / scale);
+         b.back = std::make_shared<pixmap>(px_size, 1 / scale);
+         full = true;
+      }
+      b.bounds = dev;
+      b.scale = scale;
+      b.content_size = content_size;
+
+      auto const& bounds = ctx.bounds;
+      if (!full && offset != b.offset)
+      {
+         // The content moves by d
+         point d = {b.offset.x - offset.x, b.offset.y - offset.y};
+         if (std::abs(d.x) >= bounds.width() || std::abs(d.y) >= bounds.height()
+            || !is_pixel_aligned(d.x, scale) || !is_pixel_aligned(d.y, scale))
+         {
+            full = true;
+         }
+         else
+         {
+            {
+               pixmap_context pm_ctx{*b.back};
+               canvas back_cnv{*pm_ctx.context()};
+               cairo_set_operator(pm_ctx.context(), CAIRO_OPERATOR_SOURCE);
+               back_cnv.draw(*b.front, d);
+            }
+            std::swap(b.front, b.back);
+
+            // Draw the exposed strips
+            if (d.x > 0)
+               render_backing(ctx, {bounds.left, bounds.top, bounds.left + d.x, bounds.bottom});
+            else if (d.x < 0)
+               render_backing(ctx, {bounds.right + d.x, bounds.top, bounds.right, bounds.bottom});
+            if (d.y > 0)
+               render_backing(ctx, {bounds.left, bounds.top, bounds.right, bounds.top + d.y});
+            else if (d.y < 0)
+               render_backing(ctx, {bounds.left, bounds.bottom + d.y, bounds.right, bounds.bottom});
+         }
+      }
+      else if (!full)
+      {
+         // Not scrolling. Redraw only the damaged area.
+         auto damaged = clip(cnv.clip_extent(), bounds);
+         if (!damaged.is_empty())
+         {
+            render_backing(ctx, {
+               std::floor(damaged.left), std::floor(damaged.top)
+             , std::ceil(damaged.right), std::ceil(damaged.bottom)
+            });
+         }
+      }
+
+      if (full)
+         render_backing(ctx, bounds);
+
+      b.offset = offset;
+      _content_dirty = false;
+      cnv.draw(*b.front, bounds.top_left());
+      return true;
+   }
+
    void scroller_base::draw(context const& ctx)
    {
-      port_element::draw(ctx);
+      if (!is_blit() || !draw_blit(ctx))
+         port_element::draw(ctx);
 
       if (has_scrollbars())
       {
@@ -372,43 +568,185 @@ namespace cycfi::elements
       }
    }
 
-   bool scroller_base::scroll(context const& ctx, point dir, point p)
+   namespace
+   {
+      using namespace std::chrono_literals;
+
+      // Kinetic scrolling parameters
+      constexpr auto coast_frame = 16ms;           // Frame period while coasting
+      constexpr auto coast_settle = 32ms;          // Quiet time before we start coasting
+      constexpr double velocity_smoothing = 0.6;   // Weight of the latest sample
+      constexpr double velocity_decay = 0.325;     // Decay time constant (seconds)
+      constexpr double min_velocity = 20;          // Pixels per second
+      constexpr double max_velocity = 8000;        // Pixels per second
+
+      double seconds(std::chrono::steady_clock::duration d)
+      {
+         return std::chrono::duration<double>(d).count();
+      }
+   }
+
+   bool scroller_base::scroll_by(point dir)
    {
-      view_limits e_limits = subject().limits(ctx);
       bool redraw = false;
 
-      if (allow_hscroll())
+      if (allow_hscroll() && _scroll_range.x > 0)
       {
-         double dx = (-dir.x / (e_limits.min.x - ctx.bounds.width()));
-         if ((dx > 0 && halign() < 1.0) || (dx < 0 && halign() > 0.0))
+         double alx = halign() - (dir.x / _scroll_range.x);
+         clamp(alx, 0.0, 1.0);
+         if (alx != halign())
          {
-            double alx = halign() + dx;
-            clamp(alx, 0.0, 1.0);
             halign(alx);
             redraw = true;
          }
       }
 
-      if (allow_vscroll())
+      if (allow_vscroll() && _scroll_range.y > 0)
       {
-         double dy = (-dir.y / (e_limits.min.y - ctx.bounds.height()));
-         if ((dy > 0 && valign() < 1.0) || (dy < 0 && valign() > 0.0))
+         double aly = valign() - (dir.y / _scroll_range.y);
+         clamp(aly, 0.0, 1.0);
+         if (aly != valign())
          {
-            double aly = valign() + dy;
-            clamp(aly, 0.0, 1.0);
             valign(aly);
             redraw = true;
          }
       }
+      return redraw;
+   }
 
+   bool scroller_base::scroll_by(context const& ctx, point dir)
+   {
+      view_limits e_limits = subject().limits(ctx);
+      _scroll_range = {
+         std::max<float>(e_limits.min.x - ctx.bounds.width(), 0)
+       , std::max<float>(e_limits.min.y - ctx.bounds.height(), 0)
+      };
+
+      bool redraw = scroll_by(dir);
       if (redraw)
       {
          on_scroll(point(halign(), valign()));
          ctx.view.refresh(ctx);
       }
+      return redraw;
+   }
+
+   bool scroller_base::scroll(context const& ctx, point dir, point p)
+   {
+      bool redraw = scroll_by(ctx, dir);
+      if (is_kinetic())
+      {
+         if (redraw)
+            track_velocity(ctx, dir);
+         else
+            stop_coasting();
+      }
       return port_element::scroll(ctx, dir, p) || redraw;
    }
 
+   /**
+    * @brief
+    *    Update the scroll velocity estimate from the latest scroll event and
+    *    schedule coasting, which begins if no other scroll event arrives in
+    *    the meantime.
+    */
+   void scroller_base::track_velocity(context const& ctx, point dir)
+   {
+      auto now = std::chrono::steady_clock::now();
+      auto dt = seconds(now - _last_scroll);
+      _last_scroll = now;
+
+      if (dt <= 0 || dt > seconds(coast_settle * 2))
+      {
+         // A new burst of scroll events. We have no velocity yet.
+         _velocity = {};
+      }
+      else
+      {
+         auto smooth = [dt](float v, float d)
+         {
+            double sample = std::clamp(d / dt, -max_velocity, max_velocity);
+            return float(v + (sample - v) * velocity_smoothing);
+         };
+         _velocity = {smooth(_velocity.x, dir.x), smooth(_velocity.y, dir.y)};
+      }
+
+      // Keep the scroller's device bounds. Coasting happens outside of any
+      // context, so that is what we will refresh.
+      auto tl = ctx.canvas.user_to_device(ctx.bounds.top_left());
+      auto br = ctx.canvas.user_to_device(ctx.bounds.bottom_right());
+      _device_bounds = {tl.x, tl.y, br.x, br.y};
+
+      // Make sure _this_handle is initialized to this (we may have been
+      // copied or moved)
+      if (!_this_handle || *_this_handle != this)
+         _this_handle = std::make_shared<scroller_base*>(this);
+
+      auto id = ++_coast_id;
+      this_weak_handle wp = _this_handle;
+      ctx.view.post(coast_settle,
+         [wp, &view_ = ctx.view, id]()
+         {
+            if (auto p = wp.lock())
+               (*p)->coast(view_, id);
+         }
+      );
+   }
+
+   /**
+    * @brief
+    *    Advance one frame of kinetic scrolling. The velocity decays
+    *    exponentially; the distance travelled in a frame is the integral of
+    *    the velocity over the frame's duration, so the motion does not
+    *    depend on the timer's accuracy.
+    */
+   void scroller_base::coast(view& view_, int id)
+   {
+      // Superseded by another scroll event or stopped
+      if (id != _coast_id)
+         return;
+
+      auto now = std::chrono::steady_clock::now();
+      auto dt = std::min(seconds(now - _last_scroll), seconds(coast_frame * 2));
+      _last_scroll = now;
+
+      auto decay = std::exp(-dt / velocity_decay);
+      auto travel = velocity_decay * (1.0 - decay);
+      point dp = {float(_velocity.x * travel), float(_velocity.y * travel)};
+      _velocity = {float(_velocity.x * decay), float(_velocity.y * decay)};
+
+      if (!scroll_by(dp))
+      {
+         // We hit the edge
+         stop_coasting();
+         return;
+      }
+
+      on_scroll(point(halign(), valign()));
+      view_.refresh(_device_bounds);
+
+      if (std::hypot(_velocity.x, _velocity.y) < min_velocity)
+      {
+         stop_coasting();
+         return;
+      }
+
+      this_weak_handle wp = _this_handle;
+      view_.post(coast_frame,
+         [wp, &view_, id]()
+         {
+            if (auto p = wp.lock())
+               (*p)->coast(view_, id);
+         }
+      );
+   }
+
+   void scroller_base::stop_coasting()
+   {
+      ++_coast_id;
+      _velocity = {};
+   }
+
    /**
     * @brief
     *    Sets the scroll alignment of the scroller_base.
@@ -432,6 +770,7 @@ namespace cycfi::elements
     */
    void scroller_base::set_alignment(point p)
    {
+      stop_coasting();
       if (allow_hscroll())
          halign(p.x);
       if (allow_vscroll())
@@ -444,6 +783,8 @@ namespace cycfi::elements
       {
          if (btn.down)
          {
+            stop_coasting();
+            invalidate();
             _tracking = start;
             if (reposition(ctx, btn.pos))
                return true;
@@ -456,6 +797,7 @@ namespace cycfi::elements
 
    void scroller_base::drag(context const& ctx, mouse_button btn)
    {
+      invalidate();
       if (btn.state == mouse_button::left &&
          (_tracking == none || !reposition(ctx, btn.pos)))
          port_element::drag(ctx, btn);
@@ -625,7 +967,9 @@ namespace cycfi::elements
                dp.x = bounds.right-r.right;
          }
 
-         return scroll(ctx, dp, ctx.cursor_pos());
+         stop_coasting();
+         bool redraw = scroll_by(ctx, dp);
+         return port_element::scroll(ctx, dp, ctx.cursor_pos()) || redraw;
       }
       return false;
    }
@@ -639,9 +983,11 @@ namespace cycfi::elements
          ctx.view.refresh(ctx);
       };
 
+      invalidate();
       bool handled = proxy_base::key(ctx, k);
       if (!handled && (k.action == key_action::press || k.action == key_action::repeat))
       {
+         stop_coasting();
          switch (k.key)
          {
             case key_code::home:
@@ -0,0 +1,352 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/element/table.hpp>
+#include <elements/element/port.hpp>
+#include <elements/support/canvas.hpp>
+#include <elements/view.hpp>
+#include <algorithm>
+
+namespace cycfi::elements
+{
+   table::table(
+      composer_ptr composer
+    , std::size_t frozen_rows
+    , std::size_t frozen_columns
+   )
+    : _composer{std::move(composer)}
+    , _frozen_rows{frozen_rows}
+    , _frozen_columns{frozen_columns}
+   {}
+
+   view_limits table::limits(basic_context const& ctx) const
+   {
+      sync(ctx);
+      auto w = float(_columns.total());
+      auto h = float(_rows.total());
+      return {{w, h}, {w, h}};
+   }
+
+   void table::layout(context const& ctx)
+   {
+      if (_previous_size.x != ctx.bounds.width() ||
+         _previous_size.y != ctx.bounds.height())
+      {
+         _previous_size.x = ctx.bounds.width();
+         _previous_size.y = ctx.bounds.height();
+         ++_layout_id;
+      }
+   }
+
+   /**
+    * \brief
+    *    Discard all cells and rebuild the row and column offsets from the
+    *    composer. Call this when the number of rows or columns changes.
+    */
+   void table::update()
+   {
+      _update_request = true;
+      _cells.clear();
+      _resized_rows.clear();
+      _resized_columns.clear();
+   }
+
+   /**
+    * \brief
+    *    Notify the table that the height of `row` has changed. Only the
+    *    row's offset entry is updated, in O(log n).
+    */
+   void table::resize_row(std::size_t row)
+   {
+      _resized_rows.push_back(row);
+   }
+
+   /**
+    * \brief
+    *    Notify the table that the width of `col` has changed. Only the
+    *    column's offset entry is updated, in O(log n).
+    */
+   void table::resize_column(std::size_t col)
+   {
+      _resized_columns.push_back(col);
+   }
+
+   void table::sync(basic_context const& ctx) const
+   {
+      if (!_composer)
+         return;
+
+      if (_update_request)
+      {
+         _rows.build(_composer->num_rows(),
+            [&](std::size_t i) { return _composer->row_height(i, ctx); });
+         _columns.build(_composer->num_columns(),
+            [&](std::size_t i) { return _composer->column_width(i, ctx); });
+         _update_request = false;
+      }
+      else
+      {
+         for (auto i : _resized_rows)
+         {
+            if (i < _rows.size())
+               _rows.set(i, _composer->row_height(i, ctx));
+         }
+         for (auto i : _resized_columns)
+         {
+            if (i < _columns.size())
+               _columns.set(i, _composer->column_width(i, ctx));
+         }
+      }
+      _resized_rows.clear();
+      _resized_columns.clear();
+   }
+
+   namespace
+   {
+      // How far the frozen rows and columns are pushed to stay pinned to
+      // the top-left of the visible area.
+      float frozen_offset(float start, float visible_start, float full, float frozen)
+      {
+         return std::clamp(visible_start - start, 0.0f, std::max(full - frozen, 0.0f));
+      }
+   }
+
+   table::shift_info table::frozen_shift(rect const& bounds, rect const& visible) const
+   {
+      auto frozen_w = float(_columns.offset(std::min(_frozen_columns, _columns.size())));
+      auto frozen_h = float(_rows.offset(std::min(_frozen_rows, _rows.size())));
+      return {
+         frozen_offset(bounds.left, visible.left, bounds.width(), frozen_w)
+       , frozen_offset(bounds.top, visible.top, bounds.height(), frozen_h)
+       , frozen_w
+       , frozen_h
+      };
+   }
+
+   rect table::bounds_of(context const& ctx, std::size_t row, std::size_t col) const
+   {
+      return bounds_of(ctx.bounds, frozen_shift(ctx.bounds, get_port_bounds(ctx)), row, col);
+   }
+
+   rect table::bounds_of(rect const& bounds, shift_info const& shift, std::size_t row, std::size_t col) const
+   {
+      auto left = bounds.left + float(_columns.offset(col));
+      auto top = bounds.top + float(_rows.offset(row));
+      if (col < _frozen_columns)
+         left += shift.x;
+      if (row < _frozen_rows)
+         top += shift.y;
+      return {left, top, left + float(_columns[col]), top + float(_rows[row])};
+   }
+
+   table::cell_info& table::get_cell(std::size_t row, std::size_t col) const
+   {
+      auto& cell = _cells[make_key(row, col)];
+      if (!cell.elem_ptr)
+      {
+         cell.elem_ptr = _composer->compose(row, col);
+         cell.layout_id = -1;
+      }
+      return cell;
+   }
+
+   /**
+    * \brief
+    *    Find the cell at point `p`, taking the frozen rows and columns into
+    *    account. O(log n).
+    */
+   table::cell_index table::cell_at(context const& ctx, point p) const
+   {
+      return cell_at(ctx.bounds, frozen_shift(ctx.bounds, get_port_bounds(ctx)), p);
+   }
+
+   table::cell_index table::cell_at(rect const& bounds, shift_info const& shift, point p) const
+   {
+      if (!bounds.includes(p) || _rows.empty() || _columns.empty())
+         return {};
+
+      auto find = [](fenwick_tree<double> const& axis, std::size_t frozen
+        , float pos, float shift_, float frozen_size) -> std::size_t
+      {
+         frozen = std::min(frozen, axis.size());
+         if (frozen && pos >= shift_ && pos < shift_ + frozen_size)
+            return axis.find(pos - shift_);
+         auto i = axis.find(pos);
+         return (i < frozen)? axis.size() : i; // hidden under the frozen cells
+      };
+
+      auto row = find(_rows, _frozen_rows, p.y - bounds.top, shift.y, shift.frozen_h);
+      auto col = find(_columns, _frozen_columns, p.x - bounds.left, shift.x, shift.frozen_w);
+      if (row >= _rows.size() || col >= _columns.size())
+         return {};
+      return {row, col};
+   }
+
+   void table::draw_cells(
+      context const& ctx, shift_info const& shift, rect clip_
+    , std::size_t row_first, std::size_t row_last
+    , std::size_t col_first, std::size_t col_last
+   )
+   {
+      if (row_first >= row_last || col_first >= col_last)
+         return;
+      if (clip_.right <= clip_.left || clip_.bottom <= clip_.top)
+         return;
+
+      auto& cnv = ctx.canvas;
+      auto state = cnv.new_state();
+      cnv.add_rect(clip_);
+      cnv.clip();
+
+      for (auto row = row_first; row != row_last; ++row)
+      {
+         for (auto col = col_first; col != col_last; ++col)
+         {
+            auto& cell = get_cell(row, col);
+            context cctx{ctx, cell.elem_ptr.get(), bounds_of(ctx.bounds, shift, row, col)};
+            if (cell.layout_id != _layout_id)
+            {
+               cell.elem_ptr->layout(cctx);
+               cell.layout_id = _layout_id;
+            }
+            cell.elem_ptr->draw(cctx);
+         }
+      }
+   }
+
+   void table::draw(context const& ctx)
+   {
+      sync(ctx);
+
+      auto& cnv = ctx.canvas;
+      auto  clip_extent = cnv.clip_extent();
+      if (!_composer || !intersects(ctx.bounds, clip_extent))
+         return;
+
+      auto visible = clip(clip_extent, ctx.bounds);
+      auto shift = frozen_shift(ctx.bounds, get_port_bounds(ctx));
+      auto frozen_rows = std::min(_frozen_rows, _rows.size());
+      auto frozen_cols = std::min(_frozen_columns, _columns.size());
+
+      // The body area excludes the pinned frozen rows and columns
+      auto body_left = ctx.bounds.left + shift.x + shift.frozen_w;
+      auto body_top = ctx.bounds.top + shift.y + shift.frozen_h;
+      rect body = {
+         std::max(visible.left, body_left), std::max(visible.top, body_top)
+       , visible.right, visible.bottom
+      };
+
+      // Visible range of scrolling rows and columns: O(log n)
+      auto row_first = std::max(frozen_rows, _rows.find(body.top - ctx.bounds.top));
+      auto row_last = std::min(_rows.size(), _rows.find(body.bottom - ctx.bounds.top) + 1);
+      auto col_first = std::max(frozen_cols, _columns.find(body.left - ctx.bounds.left));
+      auto col_last = std::min(_columns.size(), _columns.find(body.right - ctx.bounds.left) + 1);
+
+      rect frozen_col_area = {visible.left, body.top, std::min(body_left, visible.right), visible.bottom};
+      rect frozen_row_area = {body.left, visible.top, visible.right, std::min(body_top, visible.bottom)};
+      rect corner_area = {visible.left, visible.top, frozen_col_area.right, frozen_row_area.bottom};
+
+      draw_cells(ctx, shift, body, row_first, row_last, col_first, col_last);
+      draw_cells(ctx, shift, frozen_col_area, row_first, row_last, 0, frozen_cols);
+      draw_cells(ctx, shift, frozen_row_area, 0, frozen_rows, col_first, col_last);
+      draw_cells(ctx, shift, corner_area, 0, frozen_rows, 0, frozen_cols);
+
+      // Release the cells that are no longer within the port, except those
+      // we are tracking. The cache holds only the visible cells, so this is
+      // proportional to the number of visible cells.
+      auto port = get_port_bounds(ctx);
+      for (auto i = _cells.begin(); i != _cells.end();)
+      {
+         cell_index ix = {std::size_t(i->first >> 32), std::size_t(i->first & 0xffffffff)};
+         bool keep = ix == _click_tracking || ix == _cursor_tracking ||
+            (ix.row < _rows.size() && ix.col < _columns.size()
+               && intersects(port, bounds_of(ctx.bounds, shift, ix.row, ix.col)));
+         if (keep)
+            ++i;
+         else
+            i = _cells.erase(i);
+      }
+   }
+
+   template <typename F>
+   bool table::with_cell(context const& ctx, cell_index ix, F&& f)
+   {
+      if (!ix.is_valid() || ix.row >= _rows.size() || ix.col >= _columns.size())
+         return false;
+      auto& cell = get_cell(ix.row, ix.col);
+      context cctx{ctx, cell.elem_ptr.get(), bounds_of(ctx, ix.row, ix.col)};
+      return f(*cell.elem_ptr, cctx);
+   }
+
+   element* table::hit_test(context const& ctx, point p, bool leaf, bool control)
+   {
+      element* hit = nullptr;
+      with_cell(ctx, cell_at(ctx, p),
+         [&](element& e, context const& cctx)
+         {
+            if (auto leaf_hit = e.hit_test(cctx, p, true, control))
+               hit = leaf? leaf_hit : &e;
+            return true;
+         }
+      );
+      return hit;
+   }
+
+   bool table::click(context const& ctx, mouse_button btn)
+   {
+      auto ix = btn.down? cell_at(ctx, btn.pos) : _click_tracking;
+      bool r = with_cell(ctx, ix,
+         [&](element& e, context const& cctx)
+         {
+            return e.wants_control() && e.click(cctx, btn);
+         }
+      );
+      _click_tracking = (r && btn.down)? ix : cell_index{};
+      return r;
+   }
+
+   void table::drag(context const& ctx, mouse_button btn)
+   {
+      with_cell(ctx, _click_tracking,
+         [&](element& e, context const& cctx)
+         {
+            e.drag(cctx, btn);
+            return true;
+         }
+      );
+   }
+
+   bool table::cursor(context const& ctx, point p, cursor_tracking status)
+   {
+      auto ix = (status == cursor_tracking::leaving)? cell_index{} : cell_at(ctx, p);
+      if (ix != _cursor_tracking)
+      {
+         with_cell(ctx, _cursor_tracking,
+            [&](element& e, context const& cctx)
+            {
+               return e.cursor(cctx, p, cursor_tracking::leaving);
+            }
+         );
+         _cursor_tracking = ix;
+         status = cursor_tracking::entering;
+      }
+      return with_cell(ctx, ix,
+         [&](element& e, context const& cctx)
+         {
+            return e.cursor(cctx, p, status);
+         }
+      );
+   }
+
+   bool table::scroll(context const& ctx, point dir, point p)
+   {
+      return with_cell(ctx, cell_at(ctx, p),
+         [&](element& e, context const& cctx)
+         {
+            return e.scroll(cctx, dir, p);
+         }
+      );
+   }
+}
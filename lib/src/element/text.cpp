@@ -11,6 +11,8 @@
 #include <elements/element/traversal.hpp>
 #include <elements/view.hpp>
 #include <utility>
+#include <algorithm>
+#include <iterator>
 
 namespace cycfi::elements
 {
@@ -25,9 +27,11 @@ namespace cycfi::elements
     , color color_
    )
     : _text(std::move(text))
-    , _layout(_text.data(), _text.data() + _text.size(), font_, font_.size())
+    , _layout(_text.data(), _text.data(), font_, font_.size())
     , _color(color_)
-   {}
+   {
+      rebuild();
+   }
 
    view_limits static_text_box::limits(basic_context const& /* ctx */) const
    {
@@ -51,9 +55,8 @@ namespace cycfi::elements
    {
       sync();
 
-      _rows.clear();
       auto  new_x = ctx.bounds.width();
-      _layout.break_lines(new_x, _rows);
+      break_rows(new_x);
       auto  size = _layout.metrics();
       auto  new_y = _rows.size() * (size.ascent + size.descent + size.leading);
 
@@ -95,18 +98,158 @@ namespace cycfi::elements
 
    void static_text_box::sync() const
    {
+      // Rebuild everything if _text was changed behind our back
       auto f = _text.data();
       auto l = _text.data() + _text.size();
-      if (_current_size.x != -1 && (f != _layout.begin() || l != _layout.end()))
-         _layout.text(f, l);
+      if (_paragraphs.empty()
+         || f != _paragraphs.front().run.begin()
+         || l != _paragraphs.back().run.end())
+      {
+         rebuild();
+      }
+   }
+
+   /**
+    * \brief
+    *    Split the text from byte offsets `first` to `last` into paragraphs
+    *    and shape each one. A new paragraph starts at each newline after
+    *    `first`.
+    */
+   void static_text_box::split(std::size_t first, std::size_t last, paragraphs& out) const
+   {
+      auto data = _text.data();
+      for (auto i = first; i < last;)
+      {
+         auto end = std::size_t(std::find(data + i + 1, data + last, '\n') - data);
+         out.push_back(paragraph{i, master_glyphs{data + i, data + end, _layout}, {}});
+         i = end;
+      }
+   }
+
+   void static_text_box::rebuild() const
+   {
+      _paragraphs.clear();
+      split(0, _text.size(), _paragraphs);
+      if (_paragraphs.empty())
+      {
+         _paragraphs.push_back(
+            paragraph{0, master_glyphs{_text.data(), _text.data(), _layout}, {}}
+         );
+      }
+   }
+
+   /**
+    * \brief
+    *    Point the paragraphs, and their rows, back into _text, after it is
+    *    edited or reallocated. This does not reshape anything.
+    */
+   void static_text_box::relocate() const
+   {
+      auto data = _text.data();
+      for (auto& para : _paragraphs)
+      {
+         auto offset = (data + para.start) - para.run.begin();
+         if (offset != 0)
+         {
+            para.run.relocate(offset);
+            for (auto& row : para.rows)
+               row.relocate(offset);
+         }
+      }
+   }
+
+   /**
+    * \brief
+    *    Break the paragraphs into rows, given the width. Only paragraphs
+    *    that were reshaped, or were broken at a different width, are
+    *    re-broken.
+    *
+    *    Each paragraph is broken on its own. Its first row keeps its
+    *    leading spaces. Its other rows, the last one included, drop them.
+    */
+   void static_text_box::break_rows(float width)
+   {
+      _rows.clear();
+      for (auto& para : _paragraphs)
+      {
+         if (para.width != width)
+         {
+            para.rows.clear();
+            para.run.break_lines(width, para.rows);
+            para.width = width;
+         }
+         _rows.insert(_rows.end(), para.rows.begin(), para.rows.end());
+      }
+   }
+
+   /**
+    * \brief
+    *    Replace `count` bytes of the text, starting at byte offset `pos`,
+    *    with `ins`.
+    *
+    *    Only the paragraphs touched by the edit are reshaped and re-broken.
+    *    The paragraphs after the edit are merely shifted. This keeps the
+    *    cost of an edit proportional to the size of the edited paragraph,
+    *    not to the size of the whole text.
+    */
+   void static_text_box::replace_text(std::size_t pos, std::size_t count, string_view ins)
+   {
+      sync();
+      pos = std::min(pos, _text.size());
+      count = std::min(count, _text.size() - pos);
+
+      // Find the paragraph that contains `offset`
+      auto para_at = [this](std::size_t offset)
+      {
+         auto i = std::upper_bound(
+            _paragraphs.begin(), _paragraphs.end(), offset
+          , [](std::size_t offset, paragraph const& para)
+            {
+               return offset < para.start;
+            }
+         );
+         return std::size_t(i - _paragraphs.begin()) - 1;
+      };
+
+      // The affected paragraphs are [first, last). If the edit starts at a
+      // paragraph's newline, the previous paragraph is affected as well.
+      auto first = para_at(pos);
+      if (first > 0 && _paragraphs[first].start == pos)
+         --first;
+      auto last = para_at(pos + count) + 1;
+
+      auto region_start = _paragraphs[first].start;
+      auto region_end =
+         (last < _paragraphs.size())? _paragraphs[last].start : _text.size();
+
+      _text.replace(pos, count, ins.data(), ins.size());
+      region_end = region_end + ins.size() - count;
+
+      // Shift the paragraphs after the edit
+      for (auto i = last; i < _paragraphs.size(); ++i)
+         _paragraphs[i].start = _paragraphs[i].start + ins.size() - count;
+
+      // Reshape the affected paragraphs
+      paragraphs reshaped;
+      split(region_start, region_end, reshaped);
+      auto i = _paragraphs.erase(_paragraphs.begin() + first, _paragraphs.begin() + last);
+      _paragraphs.insert(
+         i, std::make_move_iterator(reshaped.begin()), std::make_move_iterator(reshaped.end())
+      );
+
+      if (_paragraphs.empty())
+         rebuild();
+      else
+         relocate();
+
+      break_rows(_current_size.x);
    }
 
    void static_text_box::set_text(string_view text)
    {
       _text = std::string(text);
-      _rows.clear();
-      _layout.text(_text.data(), _text.data() + _text.size());
-      _layout.break_lines(_current_size.x, _rows);
+      rebuild();
+      break_rows(_current_size.x);
    }
 
    void static_text_box::value(string_view val)
@@ -252,24 +395,6 @@ namespace cycfi::elements
       return false;
    }
 
-   namespace
-   {
-      void add_undo(
-         context const& ctx
-       , std::function<void()>& typing_state
-       , std::function<void()> undo_f
-       , std::function<void()> redo_f
-      )
-      {
-         if (typing_state)
-         {
-            ctx.view.add_undo({typing_state, undo_f});
-            typing_state = {}; // reset
-         }
-         ctx.view.add_undo({undo_f, redo_f});
-      }
-   }
-
    void break_()
    {
    }
@@ -289,21 +414,11 @@ namespace cycfi::elements
 
       std::string text = codepoint_to_utf8(info_.codepoint);
 
-      if (!_typing_state)
-         _typing_state = capture_state();
+      // Typing is merged into a single undo step
+      open_undo();
 
-      bool replace = false;
-      if (_select_start == _select_end)
-      {
-         _text.insert(_select_start, text);
-      }
-      else
-      {
-         _text.replace(_select_start, _select_end-_select_start, text);
-         replace = true;
-      }
-
-      _layout.text(_text.data(), _text.data() + _text.size());
+      bool replace = _select_start != _select_end;
+      edit(_select_start, _select_end-_select_start, text);
       layout(ctx);
 
       if (replace)
@@ -322,6 +437,7 @@ namespace cycfi::elements
 
    void basic_text_box::set_text(string_view text_)
    {
+      _undo_step.reset();
       static_text_box::set_text(text_);
       _select_start = std::min<int>(_select_start, text_.size());
       _select_end = std::min<int>(_select_end, text_.size());
@@ -342,7 +458,6 @@ namespace cycfi::elements
 
       int start = std::min(_select_end, _select_start);
       int end = std::max(_select_end, _select_start);
-      std::function<void()> undo_f = capture_state();
 
       auto up_down = [this, &ctx, k, &move_caret]()
       {
@@ -428,11 +543,13 @@ namespace cycfi::elements
             case key_code::enter:
                if (editable())
                {
-                  _text.replace(start, end-start, "\n");
+                  close_undo(ctx.view);
+                  open_undo();
+                  edit(start, end-start, "\n");
                   _select_start += 1;
                   _select_end = _select_start;
                   save_x = true;
-                  add_undo(ctx, _typing_state, undo_f, capture_state());
+                  close_undo(ctx.view);
                   handled = true;
                }
                break;
@@ -441,9 +558,11 @@ namespace cycfi::elements
             case key_code::_delete:
                if (editable())
                {
+                  close_undo(ctx.view);
+                  open_undo();
                   delete_(k.key == key_code::_delete);
                   save_x = true;
-                  add_undo(ctx, _typing_state, undo_f, capture_state());
+                  close_undo(ctx.view);
                   handled = true;
                }
                break;
@@ -511,9 +630,11 @@ namespace cycfi::elements
             case key_code::x:
                if (editable() && (k.modifiers & mod_action))
                {
+                  close_undo(ctx.view);
+                  open_undo();
                   cut(ctx.view, start, end);
                   save_x = true;
-                  add_undo(ctx, _typing_state, undo_f, capture_state());
+                  close_undo(ctx.view);
                   handled = true;
                }
                break;
@@ -529,9 +650,11 @@ namespace cycfi::elements
             case key_code::v:
                if (editable() && (k.modifiers & mod_action))
                {
+                  close_undo(ctx.view);
+                  open_undo();
                   paste(ctx.view, start, end);
                   save_x = true;
-                  add_undo(ctx, _typing_state, undo_f, capture_state());
+                  close_undo(ctx.view);
                   handled = true;
                }
                break;
@@ -539,12 +662,7 @@ namespace cycfi::elements
             case key_code::z:
                if (editable() && (k.modifiers & mod_action))
                {
-                  if (_typing_state)
-                  {
-                     ctx.view.add_undo({_typing_state, undo_f});
-                     _typing_state = {}; // reset
-                  }
-
+                  close_undo(ctx.view);
                   if (k.modifiers & mod_shift)
                      ctx.view.redo();
                   else
@@ -567,7 +685,6 @@ namespace cycfi::elements
       }
       else if (handled)
       {
-         _layout.text(_text.data(), _text.data() + _text.size());
          layout(ctx);
          auto bounds = ctx.bounds;
          auto size = current_size();
@@ -719,39 +836,22 @@ namespace cycfi::elements
       auto  metrics = _layout.metrics();
       auto  line_height = metrics.ascent + metrics.descent + metrics.leading;
 
-      char const* found = nullptr;
-      for (auto& row : _rows)
-      {
-         // Check if p is within this row
-         if ((p.y >= y) && (p.y < y + line_height))
-         {
-            // Check if we are at the very start of the row or beyond
-            if (p.x <= x)
-            {
-               found = row.begin();
-               break;
-            }
-
-            // Get the actual coordinates of the glyph
-            row.for_each(
-               [p, x, &found](char const* utf8, float left, float right)
-               {
-                  if ((p.x >= (x + left)) && (p.x < (x + right)))
-                  {
-                     found = utf8;
-                     return false;
-                  }
-                  return true;
-               }
-            );
-            // Assume it's at the end of the row if we haven't found a hit
-            if (!found)
-               found = row.end();
-            break;
-         }
-         y += line_height;
-      }
-      return found;
+      // All rows have the same height, so we can go straight to the row
+      if (p.y < y || line_height <= 0)
+         return nullptr;
+      auto  index = std::size_t((p.y - y) / line_height);
+      if (index >= _rows.size())
+         return nullptr;
+      auto& row = _rows[index];
+
+      // Check if we are at the very start of the row or beyond
+      if (p.x <= x)
+         return row.begin();
+
+      // Get the actual coordinates of the glyph. Assume it's at the end
+      // of the row if we haven't found a hit
+      auto  cluster = row.cluster_at(p.x - x);
+      return cluster.utf8? cluster.utf8 : row.end();
    }
 
    basic_text_box::glyph_metrics basic_text_box::glyph_info(context const& ctx, char const* s)
@@ -781,43 +881,38 @@ namespace cycfi::elements
          return info;
       }
 
-      glyphs*  prev_row = nullptr;
-      for (auto& row : _rows)
+      // The rows are in text order. Find the last row that starts at or
+      // before s.
+      auto  i = std::upper_bound(_rows.begin(), _rows.end(), s,
+         [](char const* s, glyphs const& row) { return s < row.begin(); }
+      );
+
+      // s is within this row
+      if (i != _rows.begin() && s < (i-1)->end())
       {
-         // Check if s is within this row
-         if (s >= row.begin() && s < row.end())
+         auto& row = *(i-1);
+         auto  row_y = y + (line_height * ((i-1) - _rows.begin()));
+         auto  cluster = row.cluster_from(s);
+         if (cluster.utf8)
          {
-            // Get the actual coordinates of the glyph
-            row.for_each(
-               [s, &info, x, y, ascent, descent](char const* utf8, float left, float right)
-               {
-                  if (utf8 >= s)
-                  {
-                     info.pos = {x + left, y};
-                     info.bounds = {x + left, y - ascent, x + right, y + descent};
-                     info.str = utf8;
-                     return false;
-                  }
-                  return true;
-               }
-            );
-            break;
-         }
-         // This handles the case where s is in between the start of the
-         // current row and the end of the previous.
-         else if (s < row.begin() && prev_row)
-         {
-            auto  rightmost = x + prev_row->width();
-            auto  prev_y = y - line_height;
-            info.pos = {rightmost, prev_y};
-            info.bounds = {rightmost, prev_y - ascent, rightmost + 10, prev_y + descent};
-            info.str = s;
-            break;
+            info.pos = {x + cluster.left, row_y};
+            info.bounds = {x + cluster.left, row_y - ascent, x + cluster.right, row_y + descent};
+            info.str = cluster.utf8;
          }
-         y += line_height;
-         prev_row = &row;
+         return info;
       }
 
+      // This handles the case where s is in between the start of a row
+      // and the end of the previous.
+      if (i != _rows.end() && _rows.size() > 1)
+      {
+         auto  prev = (i == _rows.begin())? i : i-1;
+         auto  rightmost = x + prev->width();
+         auto  prev_y = y + (line_height * (prev - _rows.begin()));
+         info.pos = {rightmost, prev_y};
+         info.bounds = {rightmost, prev_y - ascent, rightmost + 10, prev_y + descent};
+         info.str = s;
+      }
       return info;
    }
 
@@ -835,7 +930,7 @@ namespace cycfi::elements
                char const* end_p = &_text[0] + _text.size();
                char const* p = next_utf8(end_p, start_p);
                start = int(start_p - &_text[0]);
-               _text.erase(start, p - start_p);
+               edit(start, p - start_p, "");
             }
             else if (start > 0)
             {
@@ -843,12 +938,12 @@ namespace cycfi::elements
                char const* end_p = &_text[start];
                char const* p = prev_utf8(start_p, end_p);
                start = int(p - &_text[0]);
-               _text.erase(start, end_p - p);
+               edit(start, end_p - p, "");
             }
          }
          else
          {
-            _text.erase(start, end-start);
+            edit(start, end-start, "");
          }
          _select_end = _select_start = start;
       }
@@ -882,43 +977,106 @@ namespace cycfi::elements
          auto  end_ = std::max(start, end);
          auto  start_ = std::min(start, end);
          std::string ins = clipboard();
-         _text.replace(start, end_-start_, ins);
+         edit(start, end_-start_, ins);
          start += ins.size();
          _select_end = _select_start = start;
       }
    }
 
-   struct basic_text_box::state_saver
+   /**
+    * \brief
+    *    Replace `count` bytes of the text, starting at `pos`, with `ins`,
+    *    recording the edit in the current undo step, if there is one.
+    */
+   void basic_text_box::edit(std::size_t pos, std::size_t count, string_view ins)
    {
-      state_saver(basic_text_box* this_)
-       : text(this_->_text)
-       , select_start(this_->_select_start)
-       , select_end(this_->_select_end)
-       , save_text(this_->_text)
-       , save_select_start(this_->_select_start)
-       , save_select_end(this_->_select_end)
-      {}
-
-      void operator()()
+      pos = std::min(pos, _text.size());
+      count = std::min(count, _text.size() - pos);
+      if (_undo_step)
       {
-         text = save_text;
-         select_start = save_select_start;
-         select_end = save_select_end;
+         auto& ops = _undo_step->ops;
+
+         // Merge with the previous edit if we are simply continuing to type
+         if (!ops.empty() && count == 0 && ops.back().pos + ops.back().inserted.size() == pos)
+            ops.back().inserted.append(ins.data(), ins.size());
+         else
+            ops.push_back({pos, _text.substr(pos, count), std::string(ins)});
       }
+      replace_text(pos, count, ins);
+   }
+
+   void basic_text_box::open_undo()
+   {
+      if (!_undo_step)
+      {
+         _undo_step = std::make_shared<undo_step>();
+         _undo_step->select_start[0] = _select_start;
+         _undo_step->select_end[0] = _select_end;
+         _undo_step->text_size[0] = _text.size();
+      }
+   }
+
+   /**
+    * \brief
+    *    Close the current undo step, if any, and push it to the view's undo
+    *    stack. The step holds only the bytes removed and inserted, so its
+    *    size is that of the change, not of the whole text.
+    */
+   void basic_text_box::close_undo(view& v)
+   {
+      auto step = std::move(_undo_step);
+      _undo_step.reset();
+      if (!step || step->ops.empty())
+         return;
 
-      std::string&   text;
-      int&           select_start;
-      int&           select_end;
+      step->select_start[1] = _select_start;
+      step->select_end[1] = _select_end;
+      step->text_size[1] = _text.size();
 
-      std::string    save_text;
-      int            save_select_start;
-      int            save_select_end;
-   };
+      // Make sure _this_handle is initialized to this
+      if (!_this_handle || *_this_handle != this)
+         _this_handle = std::make_shared<basic_text_box*>(this);
+      this_weak_handle wp = _this_handle;
 
-   std::function<void()>
-   basic_text_box::capture_state()
+      std::size_t size = sizeof(undo_step);
+      for (auto const& op : step->ops)
+         size += sizeof(edit_op) + op.removed.size() + op.inserted.size();
+
+      v.add_undo({
+         [wp, step]()
+         {
+            if (auto p = wp.lock())
+               (*p)->apply_undo(*step, false);
+         }
+       , [wp, step]()
+         {
+            if (auto p = wp.lock())
+               (*p)->apply_undo(*step, true);
+         }
+       , size
+      });
+   }
+
+   void basic_text_box::apply_undo(undo_step const& step, bool redo)
    {
-      return state_saver(this);
+      // If the text was changed by other means since the step was recorded
+      // (e.g. set_text), its positions no longer apply.
+      if (_text.size() != step.text_size[redo? 0 : 1])
+         return;
+
+      _undo_step.reset();
+      if (redo)
+      {
+         for (auto const& op : step.ops)
+            replace_text(op.pos, op.removed.size(), op.inserted);
+      }
+      else
+      {
+         for (auto i = step.ops.rbegin(); i != step.ops.rend(); ++i)
+            replace_text(i->pos, i->inserted.size(), i->removed);
+      }
+      _select_start = step.select_start[redo];
+      _select_end = step.select_end[redo];
    }
 
    void basic_text_box::scroll_into_view(context const& ctx, bool save_x)
@@ -1178,7 +1336,7 @@ namespace cycfi::elements
             ins += *p;
          }
 
-         _text.replace(start_, end_-start_, ins);
+         edit(start_, end_-start_, ins);
          start_ += ins.size();
          select_start(start_);
          select_end(start_);
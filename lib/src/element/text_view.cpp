@@ -0,0 +1,590 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/element/text_view.hpp>
+#include <elements/element/port.hpp>
+#include <elements/support/context.hpp>
+#include <elements/view.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cycfi::elements
+{
+   using namespace std::chrono_literals;
+
+   namespace
+   {
+      constexpr auto poll_period = 250ms;             // How often we check for progress
+      constexpr std::size_t index_chunk = 1 << 20;    // Bytes indexed at a time
+   }
+
+   ////////////////////////////////////////////////////////////////////////////
+   // The document: the file, or the text_buffer, and its line index.
+   //
+   // The file is read, never mapped: a followed log may be truncated at
+   // any time (e.g. logrotate's copytruncate), and reading a mapping past
+   // the new end of the file raises SIGBUS. A read just comes up short.
+   //
+   // A text_buffer is scanned piece by piece, never flattened. The worker
+   // scans a snapshot of it, which is a cheap copy.
+   ////////////////////////////////////////////////////////////////////////////
+   struct text_view::document
+   {
+      explicit                document(fs::path path_);
+      explicit                document(text_buffer text_);
+                              ~document();
+
+      std::size_t             num_lines() const;
+      void                    line(std::size_t i, std::size_t& first, std::size_t& last) const;
+      std::size_t             read(std::size_t pos, char* buf, std::size_t n);
+      std::size_t             version() const;
+      bool                    check_growth();
+      void                    text(text_buffer text_, std::size_t changed);
+
+      void                    start(std::size_t size);
+      void                    stop();
+      void                    index(std::size_t size);
+      void                    index_text(std::size_t size);
+
+      fs::path                path;
+      std::atomic<bool>       indexing{false};
+
+   private:
+
+      mutable std::mutex      _mutex;
+      std::size_t             _size = 0;     // The file size when last (re)started
+      std::size_t             _version = 0;  // Counts the (re)starts
+      std::deque<std::size_t> _starts{0};    // Byte offset of the start of each line
+      std::size_t             _indexed = 0;  // Bytes scanned so far
+      std::atomic<bool>       _stop{false};
+      std::thread             _worker;
+      text_buffer             _text;         // In-memory documents only (path is empty)
+
+      std::ifstream           _reader;       // For `read`, on the UI thread
+      std::size_t             _reader_version = std::size_t(-1);
+   };
+
+   text_view::document::document(fs::path path_)
+    : path{std::move(path_)}
+   {
+      std::error_code ec;
+      auto size = fs::file_size(path, ec);
+      if (ec || !std::ifstream{path, std::ios::binary})
+         throw failed_to_open_text_file{"Error: Cannot open file: " + path.string()};
+      start(size);
+   }
+
+   text_view::document::document(text_buffer text_)
+    : _text{std::move(text_)}
+   {
+      start(_text.size());
+   }
+
+   text_view::document::~document()
+   {
+      stop();
+   }
+
+   void text_view::document::start(std::size_t size)
+   {
+      stop();
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         _size = size;
+         ++_version;
+      }
+      indexing = true;
+      _worker = std::thread{[this, size]() { index(size); }};
+   }
+
+   void text_view::document::stop()
+   {
+      _stop = true;
+      if (_worker.joinable())
+         _worker.join();
+      _stop = false;
+   }
+
+   /**
+    * \brief
+    *    Scan the file for newlines, from where we left off, and append the
+    *    line starts to the index a chunk at a time, up to `size` bytes.
+    *    Stops early if the file is now shorter; `check_growth` will then
+    *    start over. Runs on the worker thread.
+    */
+   void text_view::document::index(std::size_t size)
+   {
+      if (path.empty())
+      {
+         index_text(size);
+         return;
+      }
+
+      std::size_t pos;
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         pos = _indexed;
+      }
+
+      std::ifstream in{path, std::ios::binary};
+      if (!in || !in.seekg(std::streamoff(pos)))
+      {
+         indexing = false;
+         return;
+      }
+
+      std::vector<char> buf(std::min(index_chunk, size - std::min(pos, size)));
+      std::vector<std::size_t> starts;
+      while (pos < size && !_stop)
+      {
+         auto n = std::min(index_chunk, size - pos);
+         in.read(buf.data(), std::streamsize(n));
+         auto got = std::size_t(in.gcount());
+
+         starts.clear();
+         auto data = buf.data();
+         for (std::size_t i = 0; i < got;)
+         {
+            auto p = static_cast<char const*>(std::memchr(data + i, '\n', got - i));
+            if (!p)
+               break;
+            i = (p - data) + 1;
+            starts.push_back(pos + i);
+         }
+
+         std::lock_guard<std::mutex> lock{_mutex};
+         _starts.insert(_starts.end(), starts.begin(), starts.end());
+         _indexed = pos = pos + got;
+         if (got < n)
+            break;      // The file shrank
+      }
+      indexing = false;
+   }
+
+   /**
+    * \brief
+    *    Scan the text for newlines, as `index` does for a file, directly
+    *    in the pieces of a snapshot of the text.
+    */
+   void text_view::document::index_text(std::size_t size)
+   {
+      text_buffer text;
+      std::size_t pos;
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         text = _text;
+         pos = _indexed;
+      }
+
+      std::vector<std::size_t> starts;
+      while (pos < size && !_stop)
+      {
+         auto n = std::min(index_chunk, size - pos);
+         auto at = pos;
+         starts.clear();
+         text.for_each_piece(pos, n,
+            [&](string_view piece)
+            {
+               auto data = piece.data();
+               for (std::size_t i = 0; i < piece.size();)
+               {
+                  auto p = static_cast<char const*>(std::memchr(data + i, '\n', piece.size() - i));
+                  if (!p)
+                     break;
+                  i = (p - data) + 1;
+                  starts.push_back(at + i);
+               }
+               at += piece.size();
+               return true;
+            }
+         );
+
+         std::lock_guard<std::mutex> lock{_mutex};
+         _starts.insert(_starts.end(), starts.begin(), starts.end());
+         _indexed = pos = pos + n;
+      }
+      indexing = false;
+   }
+
+   /**
+    * \brief
+    *    The number of lines we can show. The last line is not complete
+    *    until the whole file is indexed. A newline at the very end of the
+    *    file does not start a new line.
+    */
+   std::size_t text_view::document::num_lines() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (indexing)
+         return _starts.size() - 1;
+      if (_starts.size() > 1 && _starts.back() == _indexed)
+         return _starts.size() - 1;
+      return _starts.size();
+   }
+
+   /**
+    * \brief
+    *    The byte range of line `i`, excluding the line terminator.
+    */
+   void text_view::document::line(std::size_t i, std::size_t& first, std::size_t& last) const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (i >= _starts.size())
+      {
+         // The file was truncated since we last looked
+         first = last = 0;
+         return;
+      }
+      first = _starts[i];
+      last = (i+1 < _starts.size())? _starts[i+1] - 1 : _indexed;
+   }
+
+   std::size_t text_view::document::version() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      return _version;
+   }
+
+   /**
+    * \brief
+    *    Read up to `n` bytes at `pos` into `buf`. Returns the number of
+    *    bytes read, which is less than `n` if the file is now shorter. The
+    *    file is opened again after each (re)start, in case it was replaced.
+    *    UI thread only.
+    */
+   std::size_t text_view::document::read(std::size_t pos, char* buf, std::size_t n)
+   {
+      if (path.empty())
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         std::size_t got = 0;
+         _text.for_each_piece(pos, n,
+            [&](string_view piece)
+            {
+               std::memcpy(buf + got, piece.data(), piece.size());
+               got += piece.size();
+               return true;
+            }
+         );
+         return got;
+      }
+
+      auto v = version();
+      if (v != _reader_version)
+      {
+         _reader.close();
+         _reader.clear();
+         _reader.open(path, std::ios::binary);
+         _reader_version = v;
+      }
+
+      _reader.clear();
+      if (!_reader.is_open() || !_reader.seekg(std::streamoff(pos)))
+         return 0;
+      _reader.read(buf, std::streamsize(n));
+      auto got = std::size_t(_reader.gcount());
+      _reader.clear();
+      return got;
+   }
+
+   /**
+    * \brief
+    *    Index what was added if the file has grown since. If it has shrunk
+    *    (e.g. it was truncated or rotated), start all over. Returns true if
+    *    the file has changed.
+    */
+   bool text_view::document::check_growth()
+   {
+      if (indexing || path.empty())
+         return false;
+
+      std::error_code ec;
+      auto size = fs::file_size(path, ec);
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         if (ec || (size == _size && _indexed == _size))
+            return false;
+
+         // Start over if the file is shorter than what we indexed, or if
+         // indexing came up short: it shrank (and maybe grew again) since
+         // we last looked.
+         if (size < _indexed || _indexed < _size)
+         {
+            _starts = {0};
+            _indexed = 0;
+         }
+      }
+      start(size);
+      return true;
+   }
+
+   /**
+    * \brief
+    *    Replace the text of an in-memory document. The lines that start
+    *    before `changed` are kept; the rest of the text is indexed again,
+    *    right away, so that the lines are never out of step with the text.
+    */
+   void text_view::document::text(text_buffer text_, std::size_t changed)
+   {
+      stop();
+      auto size = text_.size();
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         _text = std::move(text_);
+         _indexed = std::min({_indexed, changed, size});
+         while (_starts.size() > 1 && _starts.back() > _indexed)
+            _starts.pop_back();
+         _size = size;
+         ++_version;
+      }
+      indexing = true;
+      index(size);
+   }
+
+   ////////////////////////////////////////////////////////////////////////////
+   // text_view
+   ////////////////////////////////////////////////////////////////////////////
+   namespace
+   {
+      char const empty_text[] = "";
+   }
+
+   text_view::text_view(
+      fs::path path
+    , font font_
+    , color color_
+   )
+    : _doc{std::make_shared<document>(std::move(path))}
+    , _layout{empty_text, empty_text, font_, font_.size()}
+    , _color{color_}
+   {}
+
+   text_view::text_view(
+      text_buffer text
+    , font font_
+    , color color_
+   )
+    : _doc{std::make_shared<document>(std::move(text))}
+    , _layout{empty_text, empty_text, font_, font_.size()}
+    , _color{color_}
+   {}
+
+   text_view::~text_view() = default;
+
+   fs::path const& text_view::path() const
+   {
+      return _doc->path;
+   }
+
+   bool text_view::is_indexing() const
+   {
+      return _doc->indexing;
+   }
+
+   /**
+    * \brief
+    *    Replace the text of a view made from a `text_buffer`, e.g. after
+    *    an edit. `changed` is the first byte that may differ from the
+    *    previous text; pass it so that only the lines from there on are
+    *    indexed again. Call `view::layout` afterwards.
+    */
+   void text_view::text(text_buffer text_, std::size_t changed)
+   {
+      if (!_doc->path.empty())
+         return;
+      _doc->text(std::move(text_), changed);
+      _num_lines = _doc->num_lines();
+   }
+
+   float text_view::line_height() const
+   {
+      auto metrics = _layout.metrics();
+      return metrics.ascent + metrics.descent + metrics.leading;
+   }
+
+   view_limits text_view::limits(basic_context const& /* ctx */) const
+   {
+      auto height = std::max<float>(_num_lines, 1) * line_height();
+      return {{200, height}, {full_extent, height}};
+   }
+
+   void text_view::layout(context const& ctx)
+   {
+      start_polling(ctx.view);
+   }
+
+   void text_view::draw(context const& ctx)
+   {
+      start_polling(ctx.view);
+      if (_num_lines == 0)
+         return;
+
+      auto& cnv = ctx.canvas;
+      auto  state = cnv.new_state();
+      auto  metrics = _layout.metrics();
+      auto  lh = line_height();
+      auto  visible = clip(cnv.clip_extent(), ctx.bounds);
+      if (visible.is_empty() || lh <= 0)
+         return;
+
+      // Find and shape only the visible lines
+      auto first = std::size_t(std::max(0.0f, (visible.top - ctx.bounds.top) / lh));
+      auto last = std::size_t(std::ceil((visible.bottom - ctx.bounds.top) / lh));
+      first = std::min(first, _num_lines);
+      last = std::min(last, _num_lines);
+      shape(first, last);
+
+      cnv.add_rect(ctx.bounds);
+      cnv.clip();
+      cnv.fill_style(_color);
+      for (auto& line : _lines)
+      {
+         auto y = ctx.bounds.top + (line.line * lh) + metrics.ascent;
+         line.glyphs.draw({ctx.bounds.left, y}, cnv);
+      }
+   }
+
+   /**
+    * \brief
+    *    Make sure lines `first` to `last` are shaped, keeping the lines
+    *    that are still visible from the previous call, and dropping the
+    *    rest.
+    */
+   void text_view::shape(std::size_t first, std::size_t last)
+   {
+      // If the file has changed, the lines we have may be stale
+      auto version = _doc->version();
+      if (version != _version)
+      {
+         _lines.clear();
+         _version = version;
+      }
+
+      while (!_lines.empty() && _lines.front().line < first)
+         _lines.pop_front();
+      while (!_lines.empty() && _lines.back().line >= last)
+         _lines.pop_back();
+
+      if (_lines.empty())
+      {
+         for (auto i = first; i < last; ++i)
+            _lines.push_back(shape(i));
+      }
+      else
+      {
+         for (auto i = _lines.front().line; i > first; --i)
+            _lines.push_front(shape(i-1));
+         for (auto i = _lines.back().line+1; i < last; ++i)
+            _lines.push_back(shape(i));
+      }
+   }
+
+   text_view::shaped_line text_view::shape(std::size_t line) const
+   {
+      std::size_t first, last;
+      _doc->line(line, first, last);
+      first = std::min(first, last);
+
+      // Read one byte past the length limit, to see if we cut a UTF-8
+      // sequence. A short read (the file shrank) gives a shorter line.
+      auto n = std::min(last - first, max_line_bytes + 1);
+      auto text = std::make_unique<char[]>(std::max<std::size_t>(n, 1));
+      auto buf = text.get();
+      n = _doc->read(first, buf, n);
+      auto size = n;
+      if (size > 0 && size == last - first && buf[size-1] == '\r')
+         --size;
+
+      // Limit the line length, but don't cut a UTF-8 sequence in half
+      if (size > max_line_bytes)
+      {
+         size = max_line_bytes;
+         while (size > 0 && (std::uint8_t(buf[size]) & 0xC0) == 0x80)
+            --size;
+      }
+
+      // The file may not be valid UTF-8. Show nothing for lines that
+      // can't be shaped.
+      try
+      {
+         return {line, std::move(text), master_glyphs{buf, buf + size, _layout}};
+      }
+      catch (failed_to_build_master_glyphs const&)
+      {
+         return {line, std::move(text), master_glyphs{buf, buf, _layout}};
+      }
+   }
+
+   void text_view::start_polling(view& v)
+   {
+      if (_polling || (!_follow_tail && !_doc->indexing && _num_lines == _doc->num_lines()))
+         return;
+
+      // Make sure _this_handle is initialized to this (we may have been
+      // copied or moved)
+      if (!_this_handle || *_this_handle != this)
+         _this_handle = std::make_shared<text_view*>(this);
+
+      _polling = true;
+      this_weak_handle wp = _this_handle;
+      v.post(poll_period,
+         [wp, &v]()
+         {
+            if (auto p = wp.lock())
+               (*p)->poll(v);
+         }
+      );
+   }
+
+   /**
+    * \brief
+    *    Pick up the lines indexed since the last time we were here, and
+    *    relayout. When following the tail, check for file growth first, and
+    *    stay at the bottom if we were there.
+    */
+   void text_view::poll(view& v)
+   {
+      _polling = false;
+      if (_follow_tail)
+         _doc->check_growth();
+
+      auto n = _doc->num_lines();
+      if (n != _num_lines)
+      {
+         bool at_bottom = false;
+         if (_follow_tail)
+         {
+            v.in_context_do(*this,
+               [&at_bottom](context const& ctx)
+               {
+                  at_bottom = ctx.bounds.bottom <= get_port_bounds(ctx).bottom + 1;
+               }
+            );
+         }
+
+         _num_lines = n;
+         v.layout(*this);
+
+         if (at_bottom)
+         {
+            auto lh = line_height();
+            v.in_context_do(*this,
+               [lh](context const& ctx)
+               {
+                  auto const& b = ctx.bounds;
+                  scrollable::find(ctx).scroll_into_view({b.left, b.bottom - lh, b.left, b.bottom});
+               }
+            );
+         }
+      }
+      start_polling(v);
+   }
+}
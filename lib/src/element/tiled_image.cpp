@@ -0,0 +1,343 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/element/tiled_image.hpp>
+#include <elements/element/port.hpp>
+#include <elements/support/context.hpp>
+#include <elements/support/pixmap_loader.hpp>
+#include <elements/view.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace cycfi::elements
+{
+   ////////////////////////////////////////////////////////////////////////////
+   // Tile sources
+   ////////////////////////////////////////////////////////////////////////////
+
+   // By default, down to the level that fits in a single tile
+   std::size_t tile_source::num_levels() const
+   {
+      auto s = size();
+      auto tile = float(tile_size());
+      std::size_t n = 1;
+      while ((s.x > tile || s.y > tile) && n < 32)
+      {
+         s = {std::ceil(s.x / 2), std::ceil(s.y / 2)};
+         ++n;
+      }
+      return n;
+   }
+
+   extent tile_source::level_size(std::size_t level) const
+   {
+      auto s = size();
+      auto div = float(std::uint32_t(1) << level);
+      return {std::ceil(s.x / div), std::ceil(s.y / div)};
+   }
+
+   tile_pyramid::tile_pyramid(
+      fs::path dir
+    , extent size
+    , std::size_t tile_size
+    , std::string ext
+   )
+    : _dir{std::move(dir)}
+    , _size{size}
+    , _tile_size{tile_size}
+    , _ext{std::move(ext)}
+   {}
+
+   pixmap_ptr tile_pyramid::tile(std::size_t level, std::size_t col, std::size_t row) const
+   {
+      auto name = std::to_string(col) + '_' + std::to_string(row) + _ext;
+      return std::make_shared<pixmap>(_dir / std::to_string(level) / name);
+   }
+
+   tile_generator::tile_generator(
+      extent size
+    , generate_function generate
+    , std::size_t tile_size
+   )
+    : _size{size}
+    , _generate{std::move(generate)}
+    , _tile_size{tile_size}
+   {}
+
+   pixmap_ptr tile_generator::tile(std::size_t level, std::size_t col, std::size_t row) const
+   {
+      return _generate(level, col, row);
+   }
+
+   ////////////////////////////////////////////////////////////////////////////
+   // tiled_image
+   ////////////////////////////////////////////////////////////////////////////
+   bool tiled_image::tile_key::operator==(tile_key const& rhs) const
+   {
+      return level == rhs.level && col == rhs.col && row == rhs.row;
+   }
+
+   std::size_t tiled_image::tile_key_hash::operator()(tile_key const& k) const
+   {
+      auto h = (std::uint64_t(k.col) << 32) | k.row;
+      return std::hash<std::uint64_t>{}(h ^ (std::uint64_t(k.level) * 0x9e3779b97f4a7c15ull));
+   }
+
+   bool tiled_image::tile_range::contains(tile_key k) const
+   {
+      return k.level == level
+         && k.col >= first_col && k.col < last_col
+         && k.row >= first_row && k.row < last_row;
+   }
+
+   tiled_image::tiled_image(tile_source_ptr source, float zoom)
+    : _source{std::move(source)}
+    , _zoom{zoom}
+   {}
+
+   // Copies start with an empty cache
+   tiled_image::tiled_image(tiled_image const& rhs)
+    : element{rhs}
+    , _source{rhs._source}
+    , _zoom{rhs._zoom}
+    , _budget{rhs._budget}
+   {}
+
+   tiled_image::tiled_image(tiled_image&& rhs)
+    : element{std::move(rhs)}
+    , _source{std::move(rhs._source)}
+    , _zoom{rhs._zoom}
+    , _budget{rhs._budget}
+    , _bytes{rhs._bytes}
+    , _tiles{std::move(rhs._tiles)}
+    , _map{std::move(rhs._map)}
+    , _pending{std::move(rhs._pending)}
+    , _this_handle{std::move(rhs._this_handle)}
+   {
+      // The tiles being decoded come to us
+      if (_this_handle)
+         *_this_handle = this;
+      rhs._bytes = 0;
+   }
+
+   // Once cancelled, no tile is being handed to the view, and none will be
+   tiled_image::~tiled_image()
+   {
+      for (auto& [key, load] : _pending)
+         load->cancel();
+   }
+
+   view_limits tiled_image::limits(basic_context const& /* ctx */) const
+   {
+      auto s = _source->size();
+      s = {s.x * _zoom, s.y * _zoom};
+      return {{s.x, s.y}, {s.x, s.y}};
+   }
+
+   void tiled_image::zoom(float zoom_)
+   {
+      _zoom = std::max(zoom_, 1e-6f);
+   }
+
+   void tiled_image::budget(std::size_t bytes)
+   {
+      _budget = bytes;
+      trim();
+   }
+
+   void tiled_image::draw(context const& ctx)
+   {
+      auto& cnv = ctx.canvas;
+      auto  visible = clip(cnv.clip_extent(), ctx.bounds);
+      if (visible.is_empty())
+         return;
+
+      // Pick the smallest level that still has at least one pixel per
+      // target pixel, HiDPI scale included
+      double ratio = _zoom * cnv.pixel_ratio();
+      std::size_t level = 0;
+      auto num_levels = _source->num_levels();
+      while (ratio <= 0.5 && level + 1 < num_levels)
+      {
+         ratio *= 2;
+         ++level;
+      }
+
+      // The size of a tile and of a level pixel, in user space
+      auto tile_px = float(_source->tile_size());
+      auto pixel = float(std::uint32_t(1) << level) * _zoom;
+      auto tile = tile_px * pixel;
+      auto level_size = _source->level_size(level);
+      auto cols = std::size_t(std::ceil(level_size.x / tile_px));
+      auto rows = std::size_t(std::ceil(level_size.y / tile_px));
+
+      // The range of tiles covering an area
+      auto tiles_in = [&](rect area) -> tile_range
+      {
+         return {
+            std::uint32_t(level)
+          , std::size_t(std::max(0.0f, (area.left - ctx.bounds.left) / tile))
+          , std::min(cols, std::size_t(std::max(0.0f, std::ceil((area.right - ctx.bounds.left) / tile))))
+          , std::size_t(std::max(0.0f, (area.top - ctx.bounds.top) / tile))
+          , std::min(rows, std::size_t(std::max(0.0f, std::ceil((area.bottom - ctx.bounds.top) / tile))))
+         };
+      };
+
+      // The tiles in the port (the area being redrawn may be only part of
+      // what is shown). The cache keeps them.
+      _shown = tiles_in(clip(get_port_bounds(ctx), ctx.bounds));
+
+      // Draw the tiles in the area being redrawn
+      auto redrawn = tiles_in(visible);
+      for (auto row = redrawn.first_row; row < redrawn.last_row; ++row)
+      {
+         for (auto col = redrawn.first_col; col < redrawn.last_col; ++col)
+         {
+            // Tiles along the right and bottom edges may be smaller
+            auto w = std::min(tile_px, level_size.x - (col * tile_px));
+            auto h = std::min(tile_px, level_size.y - (row * tile_px));
+            auto left = ctx.bounds.left + (col * tile);
+            auto top = ctx.bounds.top + (row * tile);
+            rect dest{left, top, left + (w * pixel), top + (h * pixel)};
+
+            tile_key key{std::uint32_t(level), std::uint32_t(col), std::uint32_t(row)};
+            auto t = find(key);
+            if (t && t->pixmap)
+            {
+               cnv.draw(*t->pixmap, dest);
+               continue;
+            }
+            if (!t)
+               request(ctx.view, key);
+            draw_fallback(cnv, key, dest, pixel);
+         }
+      }
+
+      // Cancel the requests for tiles that are no longer shown: tiles of
+      // another level, or outside the port.
+      for (auto i = _pending.begin(); i != _pending.end();)
+      {
+         if (!_shown.contains(i->first))
+         {
+            i->second->cancel();
+            i = _pending.erase(i);
+         }
+         else
+         {
+            ++i;
+         }
+      }
+   }
+
+   /**
+    * \brief
+    *    Draw the area of a missing tile from the nearest coarser level we
+    *    have, if any.
+    */
+   void tiled_image::draw_fallback(canvas& cnv, tile_key k, rect dest, float pixel)
+   {
+      auto tile_px = float(_source->tile_size());
+      auto num_levels = _source->num_levels();
+      for (std::uint32_t d = 1; k.level + d < num_levels; ++d)
+      {
+         tile_key parent{k.level + d, k.col >> d, k.row >> d};
+         auto t = find(parent);
+         if (!t || !t->pixmap)
+            continue;
+
+         // Where our tile is in the parent, in the parent's pixels
+         auto div = float(std::uint32_t(1) << d);
+         auto left = ((k.col * tile_px) / div) - (parent.col * tile_px);
+         auto top = ((k.row * tile_px) / div) - (parent.row * tile_px);
+         auto px = t->pixmap->scale();    // The size of a pixel in its user space
+         rect src{
+            left * px, top * px
+          , (left + (dest.width() / (pixel * div))) * px, (top + (dest.height() / (pixel * div))) * px
+         };
+         src = clip(src, {{0, 0}, t->pixmap->size()});
+         if (!src.is_empty())
+            cnv.draw(*t->pixmap, src, dest);
+         return;
+      }
+   }
+
+   tiled_image::tile const* tiled_image::find(tile_key k)
+   {
+      auto i = _map.find(k);
+      if (i == _map.end())
+         return nullptr;
+      _tiles.splice(_tiles.begin(), _tiles, i->second);
+      return &*i->second;
+   }
+
+   void tiled_image::insert(tile_key k, pixmap_ptr pm)
+   {
+      if (_map.find(k) != _map.end())
+         return;
+      auto bytes = sizeof(tile) + (pm? pm->bytes() : 0);
+      _tiles.push_front(tile{k, std::move(pm), bytes});
+      _map.emplace(k, _tiles.begin());
+      _bytes += bytes;
+      trim();
+   }
+
+   // Drop the least recently used tiles, but never the newest one, nor
+   // those on screen. Those would only be requested again, over and over,
+   // if the budget is too small for the screen.
+   void tiled_image::trim()
+   {
+      auto i = _tiles.end();
+      while (_bytes > _budget && i != _tiles.begin())
+      {
+         --i;
+         if (i == _tiles.begin() || _shown.contains(i->key))
+            continue;
+         _map.erase(i->key);
+         _bytes -= i->bytes;
+         i = _tiles.erase(i);
+      }
+   }
+
+   void tiled_image::request(view& v, tile_key k)
+   {
+      if (_pending.find(k) != _pending.end())
+         return;
+
+      if (!_this_handle)
+         _this_handle = std::make_shared<tiled_image*>(this);
+
+      this_weak_handle wp = _this_handle;
+      auto load = make_pixmap_async(
+         [k, source = _source]()
+         {
+            return source->tile(k.level, k.col, k.row);
+         },
+         [wp, &v, k](pixmap_ptr pm)
+         {
+            // We're on a worker thread. Hand the tile to the UI thread.
+            v.post(
+               [wp, &v, k, pm]()
+               {
+                  if (auto p = wp.lock())
+                     (*p)->loaded(v, k, pm);
+               }
+            );
+         }
+      );
+      _pending.emplace(k, std::move(load));
+   }
+
+   void tiled_image::loaded(view& v, tile_key k, pixmap_ptr pm)
+   {
+      // Drop tiles whose requests were cancelled after they were decoded
+      auto i = _pending.find(k);
+      if (i == _pending.end())
+         return;
+      _pending.erase(i);
+
+      insert(k, std::move(pm));
+      v.refresh(*this);
+   }
+}
@@ -4,8 +4,11 @@
    Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
 =============================================================================*/
 #include <elements/support/canvas.hpp>
+#include <elements/support/shaped_text_cache.hpp>
 #include <cairo.h>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 namespace cycfi { namespace elements
@@ -135,6 +138,23 @@ namespace cycfi { namespace elements
       return { float(x), float(y) };
    }
 
+   /**
+    * \brief
+    *    The number of target pixels per user unit, along the most
+    *    magnified axis. Unlike `user_to_device`, this includes the initial
+    *    transform (e.g. the HiDPI scale on Windows) and the target
+    *    surface's device scale (e.g. the HiDPI scale on GTK and macOS).
+    */
+   float canvas::pixel_ratio() const
+   {
+      double xx = 1, xy = 0, yx = 0, yy = 1;
+      cairo_user_to_device_distance(&_context, &xx, &xy);
+      cairo_user_to_device_distance(&_context, &yx, &yy);
+      double sx = 1, sy = 1;
+      cairo_surface_get_device_scale(cairo_get_target(&_context), &sx, &sy);
+      return float(std::max(std::hypot(xx, xy) * sx, std::hypot(yx, yy) * sy));
+   }
+
    void canvas::begin_path()
    {
       cairo_new_path(&_context);
@@ -323,10 +343,14 @@ namespace cycfi { namespace elements
 
    namespace
    {
-      point get_text_start(cairo_t& _context, point p, int align, char const* utf8)
+      shaped_text_ptr shape_text(cairo_t& _context, string_view utf8)
       {
-         cairo_text_extents_t extents;
-         cairo_text_extents(&_context, utf8, &extents);
+         return get_shaped_text_cache().get(cairo_get_scaled_font(&_context), utf8);
+      }
+
+      point get_text_start(cairo_t& _context, point p, int align, shaped_text const& text)
+      {
+         auto const& extents = text.extents;
 
          cairo_font_extents_t font_extents;
          cairo_scaled_font_extents(cairo_get_scaled_font(&_context), &font_extents);
@@ -363,48 +387,66 @@ namespace cycfi { namespace elements
 
          return p;
       }
+
+      // The shaped glyphs are positioned from the origin. Move them to p.
+      std::vector<cairo_glyph_t>& place_glyphs(shaped_text const& text, point p)
+      {
+         thread_local std::vector<cairo_glyph_t> glyphs;
+         glyphs.assign(text.glyphs.begin(), text.glyphs.end());
+         for (auto& g : glyphs)
+         {
+            g.x += p.x;
+            g.y += p.y;
+         }
+         return glyphs;
+      }
+
+      void show_text(cairo_t& _context, point p, int align, string_view utf8)
+      {
+         auto text = shape_text(_context, utf8);
+         p = get_text_start(_context, p, align, *text);
+         auto& glyphs = place_glyphs(*text, p);
+         cairo_show_glyphs(&_context, glyphs.data(), int(glyphs.size()));
+      }
+
+      void text_path(cairo_t& _context, point p, int align, string_view utf8)
+      {
+         auto text = shape_text(_context, utf8);
+         p = get_text_start(_context, p, align, *text);
+         auto& glyphs = place_glyphs(*text, p);
+         cairo_glyph_path(&_context, glyphs.data(), int(glyphs.size()));
+      }
    }
 
    void canvas::fill_text(point p, char const* utf8)
    {
       apply_fill_style();
-      p = get_text_start(_context, p, _state.align, utf8);
-      cairo_move_to(&_context, p.x, p.y);
-      cairo_show_text(&_context, utf8);
+      show_text(_context, p, _state.align, utf8);
    }
 
    void canvas::stroke_text(point p, char const* utf8)
    {
       apply_stroke_style();
-      p = get_text_start(_context, p, _state.align, utf8);
-      cairo_move_to(&_context, p.x, p.y);
-      cairo_text_path(&_context, utf8);
+      text_path(_context, p, _state.align, utf8);
       stroke();
    }
 
-   void canvas::fill_text(std::string_view utf8_, point p)
+   void canvas::fill_text(std::string_view utf8, point p)
    {
       apply_fill_style();
-      std::string utf8(utf8_);
-      p = get_text_start(_context, p, _state.align, utf8.c_str());
-      cairo_move_to(&_context, p.x, p.y);
-      cairo_show_text(&_context, utf8.c_str());
+      show_text(_context, p, _state.align, utf8);
    }
 
-   void canvas::stroke_text(std::string_view utf8_, point p)
+   void canvas::stroke_text(std::string_view utf8, point p)
    {
       apply_stroke_style();
-      std::string utf8(utf8_);
-      p = get_text_start(_context, p, _state.align, utf8.c_str());
-      cairo_move_to(&_context, p.x, p.y);
-      cairo_text_path(&_context, utf8.c_str());
+      text_path(_context, p, _state.align, utf8);
       stroke();
    }
 
-   canvas::text_metrics canvas::measure_text(char const* utf8)
+   canvas::text_metrics canvas::measure_text(std::string_view utf8)
    {
-      cairo_text_extents_t extents;
-      cairo_text_extents(&_context, utf8, &extents);
+      auto const& extents = shape_text(_context, utf8)->extents;
 
       cairo_font_extents_t font_extents;
       cairo_scaled_font_extents(cairo_get_scaled_font(&_context), &font_extents);
@@ -417,6 +459,11 @@ namespace cycfi { namespace elements
       };
    }
 
+   canvas::text_metrics canvas::measure_text(char const* utf8)
+   {
+      return measure_text(std::string_view{utf8});
+   }
+
    canvas::font_metrics canvas::measure_font()
    {
      cairo_font_extents_t font_extents;
@@ -438,7 +485,14 @@ namespace cycfi { namespace elements
       translate(dest.top_left());
       auto scale_ = point{w/src.width(), h/src.height()};
       scale(scale_);
-      cairo_set_source_surface(&_context, pm._surface, -src.left, -src.top);
+
+      // When drawn downscaled, draw from the pixmap's nearest mipmap level
+      // that has at least one pixel per target pixel.
+      auto ratio = pixel_ratio() * pm.scale();
+      auto surface = pm.mipmap(ratio);
+      if (!surface)     // A compressed pixmap that failed to decode
+         return;
+      cairo_set_source_surface(&_context, surface, -src.left, -src.top);
       add_rect({0, 0, w/scale_.x, h/scale_.y});
       cairo_fill(&_context);
    }
@@ -4,6 +4,7 @@
    Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
 =============================================================================*/
 #include <elements/support/draw_utils.hpp>
+#include <elements/support/shadow.hpp>
 #include <elements/support/theme.hpp>
 
 namespace cycfi::elements
@@ -49,7 +50,8 @@ namespace cycfi::elements
       cnv.fill_style(c);
       cnv.fill();
 
-      // Simulated blurred shadow. cairo does not have blur yet :-(
+      // Drop shadow, blurred once and cached. It is drawn outside the
+      // panel only, since the panel may be translucent.
       {
          auto save = cnv.new_state();
 
@@ -59,33 +61,7 @@ namespace cycfi::elements
          cnv.fill_rule(canvas::fill_odd_even);
          cnv.clip();
 
-         rect shr = bounds;
-         shr.left -= 2;
-         shr.top -= 2;
-         shr.right += 6;
-         shr.bottom += 6;
-         cnv.begin_path();
-         cnv.add_round_rect(shr, corner_radius*2);
-         cnv.fill_style(rgba(0, 0, 0, 20));
-         cnv.fill();
-
-         shr.left += 1;
-         shr.top += 1;
-         shr.right -= 2;
-         shr.bottom -= 2;
-         cnv.begin_path();
-         cnv.add_round_rect(shr, corner_radius*1.5);
-         cnv.fill_style(rgba(0, 0, 0, 30));
-         cnv.fill();
-
-         shr.left += 1;
-         shr.top += 1;
-         shr.right -= 2;
-         shr.bottom -= 2;
-         cnv.begin_path();
-         cnv.add_round_rect(shr, corner_radius);
-         cnv.fill_style(rgba(0, 0, 0, 40));
-         cnv.fill();
+         draw_shadow(cnv, bounds, 8, corner_radius, rgba(0, 0, 0, 100), {2, 2});
       }
    }
 
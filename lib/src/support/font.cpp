@@ -5,6 +5,7 @@
    Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
 =============================================================================*/
 #include <elements/support/font.hpp>
+#include <elements/support/detail/font_index.hpp>
 #include <infra/assert.hpp>
 
 #include <cairo.h>
@@ -33,9 +34,14 @@
 
 #include <map>
 #include <mutex>
+#include <set>
+#include <string>
+#include <thread>
 #include <memory>
-#include <sstream>
+#include <unordered_map>
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <utility>
 #include <type_traits>
@@ -64,6 +70,31 @@ namespace cycfi { namespace elements
          rtrim(s);
       }
 
+      inline string_view trim(string_view s)
+      {
+         auto is_trimmed = [](char ch) { return ch == ' ' || ch == '"'; };
+         while (!s.empty() && is_trimmed(s.front()))
+            s.remove_prefix(1);
+         while (!s.empty() && is_trimmed(s.back()))
+            s.remove_suffix(1);
+         return s;
+      }
+
+      // Call f for each (trimmed) family in a comma separated list of
+      // families, until f returns false. This does not allocate.
+      template <typename F>
+      void for_each_family(string_view families, F f)
+      {
+         while (!families.empty())
+         {
+            auto comma = families.find(',');
+            auto family = trim(families.substr(0, comma));
+            if (!f(family) || comma == string_view::npos)
+               break;
+            families.remove_prefix(comma + 1);
+         }
+      }
+
       inline float lerp(float a, float b, float f)
       {
          return (a * (1.0 - f)) + (b * f);
@@ -366,10 +397,10 @@ namespace cycfi { namespace elements
       struct font_entry
       {
          font_entry(FcPattern* pat, FcChar8 const* full_name, FcChar8 const* file)
-         : pattern(fc::pattern_shallow_copy_tag{}, *pat)
-         , full_name(reinterpret_cast<char const*>(full_name))
+         : full_name(reinterpret_cast<char const*>(full_name))
          , file(reinterpret_cast<char const*>(file))
          {
+            fc::pattern pattern(fc::pattern_shallow_copy_tag{}, *pat);
             if (auto w = pattern.get_weight(); w)
                weight = map_fc_weight(*w); // map the weight (normalized 0 to 100)
             else
@@ -386,7 +417,14 @@ namespace cycfi { namespace elements
                stretch = font_constants::stretch_normal;
          }
 
-         fc::pattern pattern;
+         font_entry(detail::font_index::face const& face)
+         : full_name(face.full_name)
+         , file(face.file)
+         , weight(face.weight)
+         , slant(face.slant)
+         , stretch(face.stretch)
+         {}
+
          std::string full_name;
          std::string file;
          std::uint8_t weight;
@@ -394,14 +432,14 @@ namespace cycfi { namespace elements
          std::uint8_t stretch;
       };
 
-      using font_map_type = std::map<std::string, std::vector<font_entry>>;
+      using font_map_type = std::map<std::string, std::vector<font_entry>, std::less<>>;
       font_map_type& font_map()
       {
          static font_map_type font_map_;
          return font_map_;
       }
 
-      void init_font_map()
+      std::vector<fs::path> app_font_dirs()
       {
          std::vector<fs::path> paths = font_paths();
 
@@ -416,6 +454,120 @@ namespace cycfi { namespace elements
          paths.push_back(fs::path(windir) / "fonts");
 #endif
 #endif
+         return paths;
+      }
+
+      detail::font_index& font_index()
+      {
+         static detail::font_index font_index_;
+         return font_index_;
+      }
+
+      // Applications with different font directories get different index
+      // files, so they don't invalidate each other's.
+      fs::path font_index_path(std::vector<fs::path> const& app_dirs)
+      {
+         auto dir = font_index_directory();
+         if (dir.empty())
+            return {};
+
+         std::uint64_t hash = 14695981039346656037ull;   // FNV-1a
+         for (auto const& path : app_dirs)
+         {
+            for (char c : path.generic_string() + '\n')
+            {
+               hash ^= std::uint8_t(c);
+               hash *= 1099511628211ull;
+            }
+         }
+
+         char name[64];
+         std::snprintf(name, sizeof(name), "font_index_%016llx.bin", (unsigned long long)hash);
+         return dir / name;
+      }
+
+      /**
+       * Add the subdirectories of `dir`, recursively, as fontconfig scans
+       * them. Adding a font changes the mtime of the directory it is added
+       * to, which may be any of these. `seen` holds the canonical paths of
+       * the directories added so far, to skip duplicates and symlink loops.
+       */
+      void add_font_subdirs(
+         fs::path const& dir
+       , std::vector<detail::font_index::directory>& dirs
+       , std::set<fs::path>& seen
+      )
+      {
+         std::error_code ec;
+         for (fs::directory_iterator i{dir, ec}, end; !ec && i != end; i.increment(ec))
+         {
+            if (!i->is_directory(ec) || ec)
+               continue;
+            auto canonical = fs::canonical(i->path(), ec);
+            if (ec || !seen.insert(canonical).second)
+               continue;
+            dirs.push_back({i->path(), false});
+            add_font_subdirs(i->path(), dirs, seen);
+         }
+      }
+
+      void save_font_index(fs::path const& path, std::vector<fs::path> const& app_dirs, FcConfig* config)
+      {
+         // The application directories come first, in order, as validate
+         // expects. Their subdirectories follow them.
+         std::vector<detail::font_index::directory> dirs;
+         std::set<fs::path> seen;
+         for (auto const& dir : app_dirs)
+         {
+            std::error_code ec;
+            if (auto canonical = fs::canonical(dir, ec); !ec)
+               seen.insert(canonical);
+            dirs.push_back({dir, true});
+         }
+         for (auto const& dir : app_dirs)
+            add_font_subdirs(dir, dirs, seen);
+
+         if (auto list = FcConfigGetFontDirs(config))
+         {
+            while (auto dir = FcStrListNext(list))
+            {
+               fs::path p{reinterpret_cast<char const*>(dir)};
+               std::error_code ec;
+               auto canonical = fs::canonical(p, ec);
+               if (!ec && !seen.insert(canonical).second)
+                  continue;
+               dirs.push_back({p, false});
+               add_font_subdirs(p, dirs, seen);
+            }
+            FcStrListDone(list);
+         }
+
+         // font_map is ordered by family name, as the index wants it
+         std::vector<detail::font_index::family> families;
+         for (auto const& [name, entries] : font_map())
+         {
+            detail::font_index::family family{name, {}};
+            for (auto const& e : entries)
+               family.faces.push_back({e.full_name, e.file, e.weight, e.slant, e.stretch});
+            families.push_back(std::move(family));
+         }
+
+         detail::font_index::save(path, dirs, families);
+      }
+
+      /**
+       * Get the installed fonts from the persistent font index if it is
+       * still valid. In that case, the families are added to font_map
+       * lazily, as they are asked for (see find_family). Otherwise, list
+       * all the fonts with fontconfig and save the index for the next time.
+       */
+      void init_font_map()
+      {
+         std::vector<fs::path> paths = app_font_dirs();
+         auto index_path = font_index_path(paths);
+         if (!index_path.empty() && font_index().load(index_path, paths))
+            return;
+
          fc::config& conf = fc::instance();
 
          for (auto& path : paths)
@@ -440,23 +592,51 @@ namespace cycfi { namespace elements
                font_map()[key].push_back(font_entry(font, full_name, file));
             }
          }
+
+         if (!index_path.empty())
+            save_font_index(index_path, paths, conf.get());
+      }
+
+      std::vector<font_entry> const* find_family(string_view family)
+      {
+         auto& map = font_map();
+         if (auto i = map.find(family); i != map.end())
+            return &i->second;
+
+         // Not in font_map yet. Get it from the index, if we have one.
+         std::vector<detail::font_index::face> faces;
+         if (!font_index().find(family, faces))
+            return nullptr;
+
+         auto& entries = map[std::string{family}];
+         for (auto const& face : faces)
+            entries.emplace_back(face);
+         return &entries;
       }
 
       font_entry const* match(font_descr descr)
       {
-         if (font_map().empty())
-            init_font_map();
+         static std::mutex font_map_mutex;
+         static bool font_map_initialized = false;
 
-         std::istringstream str(std::string{descr._families});
-         std::string family;
-         while (getline(str, family, ','))
+         std::lock_guard<std::mutex> lock(font_map_mutex);
+         if (!font_map_initialized)
          {
-            trim(family);
-            if (auto i = font_map().find(family); i != font_map().end())
+            init_font_map();
+            font_map_initialized = true;
+         }
+
+         font_entry const* found = nullptr;
+         for_each_family(descr._families,
+            [&](string_view family)
             {
+               auto entries = find_family(family);
+               if (!entries)
+                  return true;
+
                int min = 10000;
-               std::vector<font_entry>::const_iterator best_match = i->second.end();
-               for (auto j = i->second.begin(); j != i->second.end(); ++j)
+               std::vector<font_entry>::const_iterator best_match = entries->end();
+               for (auto j = entries->begin(); j != entries->end(); ++j)
                {
                   auto const& item = *j;
 
@@ -474,11 +654,45 @@ namespace cycfi { namespace elements
                      best_match = j;
                   }
                }
-               if (best_match != i->second.end())
-                  return &*best_match;
+               if (best_match != entries->end())
+               {
+                  found = &*best_match;
+                  return false;
+               }
+               return true;
             }
-         }
-         return nullptr;
+         );
+         return found;
+      }
+
+      // The font face matched for each font_descr, keyed by the descr's
+      // normalized families, weight, slant and stretch (but not size).
+      // Guarded by the cairo font map mutex. The faces are owned by the
+      // cairo font map; null means there is no match.
+      using font_match_map_type = std::unordered_map<std::string, cairo_font_face_t*>;
+
+      font_match_map_type& font_match_map()
+      {
+         static font_match_map_type font_match_map_;
+         return font_match_map_;
+      }
+
+      void match_key(font_descr const& descr, std::string& key)
+      {
+         key.clear();
+         for_each_family(descr._families,
+            [&key](string_view family)
+            {
+               if (!key.empty())
+                  key += ',';
+               key.append(family.data(), family.size());
+               return true;
+            }
+         );
+         key += '\0';
+         key += char(descr._weight);
+         key += char(descr._slant);
+         key += char(descr._stretch);
       }
 
 #ifndef __APPLE__
@@ -628,17 +842,58 @@ namespace cycfi { namespace elements
       return _paths;
    }
 
+   namespace
+   {
+      fs::path default_font_index_directory()
+      {
+#if defined(_WIN32)
+         if (auto dir = std::getenv("LOCALAPPDATA"); dir && *dir)
+            return fs::path(dir) / "elements";
+#elif defined(__APPLE__)
+         if (auto home = std::getenv("HOME"); home && *home)
+            return fs::path(home) / "Library" / "Caches" / "elements";
+#else
+         if (auto dir = std::getenv("XDG_CACHE_HOME"); dir && *dir)
+            return fs::path(dir) / "elements";
+         if (auto home = std::getenv("HOME"); home && *home)
+            return fs::path(home) / ".cache" / "elements";
+#endif
+         return {};
+      }
+   }
+
+   fs::path& font_index_directory()
+   {
+      static fs::path _dir = default_font_index_directory();
+      return _dir;
+   }
+
    font::font(font_descr descr)
    {
 #ifndef __APPLE__
       static free_type_library ft_lib;
 #endif
 
+      _size = descr._size;
+
+      // Reuse the key's buffer; we construct fonts often
+      thread_local std::string key;
+      match_key(descr, key);
+
+      auto [cairo_font_map, cairo_font_map_mutex] = get_cairo_font_map();
+      {
+         std::lock_guard<std::mutex> lock(cairo_font_map_mutex);
+         if (auto it = font_match_map().find(key); it != font_match_map().end())
+         {
+            _handle = it->second? cairo_font_face_reference(it->second) : nullptr;
+            return;
+         }
+      }
+
       auto match_ptr = match(descr);
+      std::lock_guard<std::mutex> lock(cairo_font_map_mutex);
       if (match_ptr)
       {
-         auto [cairo_font_map, cairo_font_map_mutex] = get_cairo_font_map();
-         std::lock_guard<std::mutex> lock(cairo_font_map_mutex);
          if (auto it = cairo_font_map.find(match_ptr->full_name); it != cairo_font_map.end())
          {
             _handle = cairo_font_face_reference(it->second);
@@ -670,7 +925,7 @@ namespace cycfi { namespace elements
       {
          _handle = nullptr;
       }
-      _size = descr._size;
+      font_match_map()[key] = _handle;
    }
 
    font::font(font const& rhs)
@@ -707,6 +962,58 @@ namespace cycfi { namespace elements
       if (_handle)
          cairo_font_face_destroy(_handle);
    }
+
+   font_warm_up::font_warm_up(std::vector<font_descr> const& descrs)
+   {
+      start(descrs);
+   }
+
+   font_warm_up::~font_warm_up()
+   {
+      wait();
+   }
+
+   /**
+    * \brief
+    *    Start warming up the fonts for `descrs`. The descriptors' family
+    *    names are copied; they need not outlive the call.
+    */
+   void font_warm_up::start(std::vector<font_descr> const& descrs)
+   {
+      wait();
+
+      std::vector<std::pair<std::string, font_descr>> fonts;
+      fonts.reserve(descrs.size());
+      for (auto const& descr : descrs)
+         fonts.emplace_back(std::string{descr._families}, descr);
+
+      _done = false;
+      _thread = std::thread{
+         [this, fonts = std::move(fonts)]() mutable
+         {
+            // The first font enumerates the installed fonts. Each one then
+            // loads its face, which stays in the font map for the next
+            // font that asks for it.
+            for (auto& [families, descr] : fonts)
+            {
+               descr._families = families;
+               font{descr};
+            }
+            _done = true;
+         }
+      };
+   }
+
+   /**
+    * \brief
+    *    Wait for the warm-up to finish. Returns immediately if it is done
+    *    or was never started.
+    */
+   void font_warm_up::wait()
+   {
+      if (_thread.joinable())
+         _thread.join();
+   }
 }}
 
 
@@ -0,0 +1,323 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/detail/font_index.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+namespace cycfi { namespace elements { namespace detail
+{
+   namespace
+   {
+      constexpr char magic[8] = {'E', 'L', 'F', 'O', 'N', 'T', 'S', '\0'};
+
+      std::int64_t mtime(fs::path const& path)
+      {
+         std::error_code ec;
+         auto t = fs::last_write_time(path, ec);
+         return ec? -1 : std::int64_t(t.time_since_epoch().count());
+      }
+   }
+
+   struct font_index::header
+   {
+      char                    magic[8];
+      std::uint32_t           version;
+      std::uint32_t           num_dirs;
+      std::uint32_t           num_families;
+      std::uint32_t           num_faces;
+      std::uint32_t           file_size;
+      std::uint32_t           reserved;
+   };
+
+   struct font_index::dir_record
+   {
+      std::uint32_t           path_offset;
+      std::uint32_t           path_size;
+      std::uint32_t           app;
+      std::uint32_t           reserved;
+      std::int64_t            mtime;
+   };
+
+   struct font_index::family_record
+   {
+      std::uint32_t           name_offset;
+      std::uint32_t           name_size;
+      std::uint32_t           first_face;
+      std::uint32_t           num_faces;
+   };
+
+   struct font_index::face_record
+   {
+      std::uint32_t           full_name_offset;
+      std::uint32_t           full_name_size;
+      std::uint32_t           file_offset;
+      std::uint32_t           file_size;
+      std::uint8_t            weight;
+      std::uint8_t            slant;
+      std::uint8_t            stretch;
+      std::uint8_t            reserved;
+   };
+
+   // The file is not trusted: it may be stale, truncated or corrupt. The
+   // records are copied out rather than cast in place, and every offset is
+   // checked before use.
+   template <typename T>
+   T font_index::read(std::size_t offset) const
+   {
+      T r;
+      std::memcpy(&r, _file.data() + offset, sizeof(T));
+      return r;
+   }
+
+   bool font_index::get_string(std::uint32_t offset, std::uint32_t size, string_view& str) const
+   {
+      if (std::size_t(offset) + size > _file.size())
+         return false;
+      str = {_file.data() + offset, size};
+      return true;
+   }
+
+   /**
+    * \brief
+    *    Map the index at `path`. Returns false, leaving the index unloaded,
+    *    if there is none, or if it is invalid or stale.
+    */
+   bool font_index::load(fs::path const& path, std::vector<fs::path> const& app_dirs)
+   {
+      try
+      {
+         _file = mapped_file{path};
+      }
+      catch (failed_to_map_file const&)
+      {
+         return false;
+      }
+
+      if (!validate(app_dirs))
+      {
+         _file = mapped_file{};
+         return false;
+      }
+      return true;
+   }
+
+   bool font_index::validate(std::vector<fs::path> const& app_dirs)
+   {
+      if (_file.size() < sizeof(header))
+         return false;
+
+      auto h = read<header>(0);
+      if (std::memcmp(h.magic, magic, sizeof(magic)) != 0
+         || h.version != version
+         || h.file_size != _file.size())
+      {
+         return false;
+      }
+
+      std::size_t dirs = sizeof(header);
+      _families = dirs + (std::size_t(h.num_dirs) * sizeof(dir_record));
+      _faces = _families + (std::size_t(h.num_families) * sizeof(family_record));
+      auto end = _faces + (std::size_t(h.num_faces) * sizeof(face_record));
+      if (end > _file.size())
+         return false;
+      _num_families = h.num_families;
+      _num_faces = h.num_faces;
+
+      // All the directories must be unchanged, and the application's font
+      // directories must be the same, in the same order.
+      std::size_t app = 0;
+      for (std::uint32_t i = 0; i != h.num_dirs; ++i)
+      {
+         auto d = read<dir_record>(dirs + (i * sizeof(dir_record)));
+         string_view path;
+         if (!get_string(d.path_offset, d.path_size, path))
+            return false;
+         if (d.app)
+         {
+            if (app == app_dirs.size() || app_dirs[app++].generic_string() != path)
+               return false;
+         }
+         if (mtime(fs::path{std::string{path}}) != d.mtime)
+            return false;
+      }
+      return app == app_dirs.size();
+   }
+
+   /**
+    * \brief
+    *    Find the faces of `family`, with a binary search over the sorted
+    *    family records. The faces refer to the mapped strings and are valid
+    *    while the index is loaded.
+    */
+   bool font_index::find(string_view family, std::vector<face>& faces) const
+   {
+      if (!is_loaded())
+         return false;
+
+      std::uint32_t first = 0;
+      std::uint32_t count = _num_families;
+      while (count > 0)
+      {
+         auto step = count / 2;
+         auto i = first + step;
+         auto f = read<family_record>(_families + (i * sizeof(family_record)));
+         string_view name;
+         if (!get_string(f.name_offset, f.name_size, name))
+            return false;
+         if (name < family)
+         {
+            first = i + 1;
+            count -= step + 1;
+         }
+         else
+         {
+            count = step;
+         }
+      }
+      if (first == _num_families)
+         return false;
+
+      auto f = read<family_record>(_families + (first * sizeof(family_record)));
+      string_view name;
+      if (!get_string(f.name_offset, f.name_size, name) || name != family)
+         return false;
+      if (std::size_t(f.first_face) + f.num_faces > _num_faces)
+         return false;
+
+      faces.clear();
+      for (std::uint32_t i = 0; i != f.num_faces; ++i)
+      {
+         auto r = read<face_record>(_faces + ((f.first_face + i) * sizeof(face_record)));
+         face fc;
+         if (!get_string(r.full_name_offset, r.full_name_size, fc.full_name)
+            || !get_string(r.file_offset, r.file_size, fc.file))
+         {
+            return false;
+         }
+         fc.weight = r.weight;
+         fc.slant = r.slant;
+         fc.stretch = r.stretch;
+         faces.push_back(fc);
+      }
+      return true;
+   }
+
+   /**
+    * \brief
+    *    Write an index of `families` (which must be sorted by name) and
+    *    `dirs` to `path`. The index is written to a temporary file first and
+    *    then renamed, so a reader never sees a partial index.
+    */
+   bool font_index::save(
+      fs::path const& path
+    , std::vector<directory> const& dirs
+    , std::vector<family> const& families
+   )
+   {
+      std::string strings;
+      auto add_string = [&](string_view s, std::uint32_t& offset, std::uint32_t& size)
+      {
+         offset = std::uint32_t(strings.size());   // Relative for now
+         size = std::uint32_t(s.size());
+         strings.append(s.data(), s.size());
+      };
+
+      std::vector<dir_record> dir_records;
+      for (auto const& d : dirs)
+      {
+         dir_record r = {};
+         auto p = d.path.generic_string();
+         add_string(p, r.path_offset, r.path_size);
+         r.app = d.app;
+         r.mtime = mtime(d.path);
+         dir_records.push_back(r);
+      }
+
+      std::vector<family_record> family_records;
+      std::vector<face_record> face_records;
+      for (auto const& f : families)
+      {
+         family_record r = {};
+         add_string(f.name, r.name_offset, r.name_size);
+         r.first_face = std::uint32_t(face_records.size());
+         r.num_faces = std::uint32_t(f.faces.size());
+         family_records.push_back(r);
+
+         for (auto const& fc : f.faces)
+         {
+            face_record fr = {};
+            add_string(fc.full_name, fr.full_name_offset, fr.full_name_size);
+            add_string(fc.file, fr.file_offset, fr.file_size);
+            fr.weight = fc.weight;
+            fr.slant = fc.slant;
+            fr.stretch = fc.stretch;
+            face_records.push_back(fr);
+         }
+      }
+
+      // Now that we know where the strings go, make their offsets absolute
+      auto strings_offset = sizeof(header)
+         + (dir_records.size() * sizeof(dir_record))
+         + (family_records.size() * sizeof(family_record))
+         + (face_records.size() * sizeof(face_record));
+      auto file_size = strings_offset + strings.size();
+      if (file_size > UINT32_MAX)
+         return false;
+
+      auto base = std::uint32_t(strings_offset);
+      for (auto& r : dir_records)
+         r.path_offset += base;
+      for (auto& r : family_records)
+         r.name_offset += base;
+      for (auto& r : face_records)
+      {
+         r.full_name_offset += base;
+         r.file_offset += base;
+      }
+
+      header h = {};
+      std::memcpy(h.magic, magic, sizeof(magic));
+      h.version = version;
+      h.num_dirs = std::uint32_t(dir_records.size());
+      h.num_families = std::uint32_t(family_records.size());
+      h.num_faces = std::uint32_t(face_records.size());
+      h.file_size = std::uint32_t(file_size);
+
+      std::error_code ec;
+      fs::create_directories(path.parent_path(), ec);
+      auto tmp = path;
+      tmp += ".tmp";
+      {
+         std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+         if (!out)
+            return false;
+
+         auto write = [&out](void const* data, std::size_t size)
+         {
+            out.write(static_cast<char const*>(data), std::streamsize(size));
+         };
+
+         write(&h, sizeof(h));
+         write(dir_records.data(), dir_records.size() * sizeof(dir_record));
+         write(family_records.data(), family_records.size() * sizeof(family_record));
+         write(face_records.data(), face_records.size() * sizeof(face_record));
+         write(strings.data(), strings.size());
+         if (!out)
+            return false;
+      }
+
+      fs::rename(tmp, path, ec);
+      if (ec)
+      {
+         fs::remove(tmp, ec);
+         return false;
+      }
+      return true;
+   }
+}}}
@@ -5,6 +5,7 @@
 =============================================================================*/
 #include <elements/support/glyphs.hpp>
 #include <elements/support/detail/scratch_context.hpp>
+#include <algorithm>
 
 namespace cycfi { namespace elements
 {
@@ -33,6 +34,7 @@ namespace cycfi { namespace elements
     , _clusters(master._clusters + cluster_start)
     , _cluster_count(cluster_end - cluster_start)
     , _clusterflags(master._clusterflags)
+    , _info(master._breaks.empty()? nullptr : master._breaks.data() + cluster_start)
    {
       CYCFI_ASSERT(_first, "Precondition failure: _first must not be null");
       CYCFI_ASSERT(_last, "Precondition failure: _last must not be null");
@@ -72,6 +74,8 @@ namespace cycfi { namespace elements
          _cluster_count -= clusters_skipped;
          _clusters = cluster;
          _first += clusters_skipped;
+         if (_info)
+            _info += clusters_skipped;
       };
 
       if (strip_leading_spaces)
@@ -122,6 +126,76 @@ namespace cycfi { namespace elements
       return 0;
    }
 
+   glyphs::cluster_bounds glyphs::cluster_at(float x)
+   {
+      if (_first == _last)
+         return {nullptr, 0, 0};
+
+      if (!_info)
+      {
+         cluster_bounds found = {nullptr, 0, 0};
+         for_each(
+            [x, &found](char const* utf8, float left, float right)
+            {
+               if ((x >= left) && (x < right))
+               {
+                  found = {utf8, left, right};
+                  return false;
+               }
+               return true;
+            }
+         );
+         return found;
+      }
+
+      // Find the last cluster starting at or before x
+      auto  first = _info;
+      auto  last = _info + _cluster_count;
+      float start_x = _glyphs->x;
+      auto  i = std::upper_bound(first, last, x + start_x,
+         [](float x, break_info const& info) { return x < info.left; }
+      );
+      if (i == first || (x + start_x) >= (--i)->right)
+         return {nullptr, 0, 0};
+      return {_first + (i->byte - first->byte), i->left - start_x, i->right - start_x};
+   }
+
+   glyphs::cluster_bounds glyphs::cluster_from(char const* utf8)
+   {
+      if (_first == _last)
+         return {nullptr, 0, 0};
+
+      if (!_info)
+      {
+         cluster_bounds found = {nullptr, 0, 0};
+         for_each(
+            [utf8, &found](char const* cluster, float left, float right)
+            {
+               if (cluster >= utf8)
+               {
+                  found = {cluster, left, right};
+                  return false;
+               }
+               return true;
+            }
+         );
+         return found;
+      }
+
+      if (utf8 < _first)
+         utf8 = _first;
+      auto  first = _info;
+      auto  last = _info + _cluster_count;
+      auto  offset = first->byte + std::uint32_t(utf8 - _first);
+      auto  i = std::lower_bound(first, last, offset,
+         [](break_info const& info, std::uint32_t offset) { return info.byte < offset; }
+      );
+      if (i == last)
+         return {nullptr, 0, 0};
+      float start_x = _glyphs->x;
+      return {_first + (i->byte - first->byte), i->left - start_x, i->right - start_x};
+   }
+
    glyphs::font_metrics glyphs::metrics() const
    {
       cairo_font_extents_t font_extents;
@@ -171,6 +245,7 @@ namespace cycfi { namespace elements
       _clusters = rhs._clusters;
       _cluster_count = rhs._cluster_count;
       _clusterflags = rhs._clusterflags;
+      _breaks = std::move(rhs._breaks);
 
       rhs._glyphs = nullptr;
       rhs._clusters = nullptr;
@@ -196,6 +271,7 @@ namespace cycfi { namespace elements
          _clusters = rhs._clusters;
          _cluster_count = rhs._cluster_count;
          _clusterflags = rhs._clusterflags;
+         _breaks = std::move(rhs._breaks);
 
          rhs._glyphs = nullptr;
          rhs._clusters = nullptr;
@@ -247,6 +323,9 @@ namespace cycfi { namespace elements
       CYCFI_ASSERT(_glyphs, "Precondition failure: _glyphs must not be null");
       CYCFI_ASSERT(_clusters, "Precondition failure: _clusters must not be null");
 
+      if (_breaks.empty())
+         compute_breaks();
+
       char const* first = _first;
       char const* last = _last;
       char const* space_pos = _first;
@@ -256,6 +335,10 @@ namespace cycfi { namespace elements
       int         space_cluster_index = 0;
       float       start_x = _glyphs->x;
 
+      // Rows are appended to `lines`. Only the first row this run adds
+      // keeps its leading spaces (e.g. a paragraph's indent).
+      auto const  first_row = lines.size();
+
       auto add_line = [&]()
       {
          glyphs glyph_{
@@ -263,7 +346,7 @@ namespace cycfi { namespace elements
           , start_glyph_index, space_glyph_index
           , start_cluster_index, space_cluster_index
           , *this
-          , lines.size() > 0 // skip leading spaces if this is not the first line
+          , lines.size() > first_row // skip leading spaces if this is not the first line
          };
          lines.push_back(std::move(glyph_));
          first = space_pos;
@@ -272,49 +355,36 @@ namespace cycfi { namespace elements
          start_x = _glyphs[space_glyph_index].x;
       };
 
-      int      glyph_index = 0;
-      unsigned codepoint;
-      unsigned state = 0;
-
-      cairo_text_cluster_t* cluster = _clusters;
-      for (auto i = _first; i != _last; ++i)
+      for (std::size_t i = 0; i != _breaks.size(); ++i)
       {
-         if (!decode_utf8(state, codepoint, uint8_t(*i)))
-         {
-            cairo_glyph_t*  glyph = _glyphs + glyph_index;
+         auto const& info = _breaks[i];
 
-            // Check if we exceeded the line width:
-            cairo_text_extents_t extents;
-            cairo_scaled_font_glyph_extents(_scaled_font, glyph, 1, &extents);
-            if (((glyph->x + extents.x_advance) - start_x) > width)
+         // Check if we exceeded the line width:
+         if ((info.right - start_x) > width)
+         {
+            if (space_pos <= first)
             {
-               if (space_pos <= first)
-               {
-                  // We must do a hard break
-                  space_glyph_index = glyph_index;
-                  space_cluster_index = int(cluster - _clusters);
-                  space_pos = i;
-               }
-
-               // Add the line if we did (exceed the line width)
-               add_line();
+               // We must do a hard break
+               space_glyph_index = int(info.glyph);
+               space_cluster_index = int(i);
+               space_pos = _first + info.byte;
             }
 
-            // Did we have a space?
-            else if (is_space(codepoint))
-            {
-               // Mark the spaces for later
-               space_glyph_index = glyph_index;
-               space_cluster_index = int(cluster - _clusters);
-               space_pos = i;
-
-               // If we got an explicit new line, add the line right away.
-               if ((space_glyph_index != start_glyph_index) && is_newline(codepoint))
-                  add_line();
-            }
+            // Add the line if we did (exceed the line width)
+            add_line();
+         }
+
+         // Did we have a space?
+         else if (info.space)
+         {
+            // Mark the spaces for later
+            space_glyph_index = int(info.glyph);
+            space_cluster_index = int(i);
+            space_pos = _first + info.byte;
 
-            glyph_index += cluster->num_glyphs;
-            ++cluster;
+            // If we got an explicit new line, add the line right away.
+            if ((space_glyph_index != start_glyph_index) && info.newline)
+               add_line();
          }
       }
 
@@ -323,14 +393,59 @@ namespace cycfi { namespace elements
        , start_glyph_index, _glyph_count
        , start_cluster_index, _cluster_count
        , *this
-       , lines.size() > 1 // skip leading spaces if this is not the first line
+       , lines.size() > first_row // skip leading spaces if this is not the first line
       };
 
       lines.push_back(std::move(glyph_));
    }
 
+   /**
+    * Measure each cluster and find the break opportunities, once per
+    * shaping. break_lines then works solely on this data, however many
+    * times it is called, at whatever width.
+    */
+   void master_glyphs::compute_breaks()
+   {
+      _breaks.clear();
+      _breaks.reserve(_cluster_count);
+
+      int         glyph_index = 0;
+      std::size_t byte_index = 0;
+      float       left = _glyph_count? float(_glyphs->x) : 0;
+      float       right = left;
+
+      for (int i = 0; i != _cluster_count; ++i)
+      {
+         auto const& cluster = _clusters[i];
+         if (glyph_index < _glyph_count)
+         {
+            cairo_glyph_t* glyph = _glyphs + glyph_index;
+            cairo_text_extents_t extents;
+            cairo_scaled_font_glyph_extents(_scaled_font, glyph, 1, &extents);
+            left = float(glyph->x);
+            right = float(glyph->x + extents.x_advance);
+         }
+         else
+         {
+            left = right;
+         }
+
+         char const* utf8 = _first + byte_index;
+         auto cp = codepoint(utf8);
+         _breaks.push_back({
+            std::uint32_t(byte_index), std::uint32_t(glyph_index)
+          , left, right, is_space(cp), is_newline(cp)
+         });
+
+         glyph_index += cluster.num_glyphs;
+         byte_index += cluster.num_bytes;
+      }
+   }
+
    void master_glyphs::build(point start)
    {
+      _breaks.clear();
+
       // reurn early if there's nothing to build
       if (_first == _last)
          return;
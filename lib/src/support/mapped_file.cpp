@@ -0,0 +1,129 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/mapped_file.hpp>
+#include <utility>
+
+#if defined(_WIN32)
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace cycfi::elements
+{
+#if defined(_WIN32)
+
+   mapped_file::mapped_file(fs::path const& path)
+   {
+      HANDLE file = CreateFileW(
+         path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE
+       , nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+      );
+      if (file == INVALID_HANDLE_VALUE)
+         throw failed_to_map_file{"Error: Cannot open file: " + path.string()};
+
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(file, &size))
+      {
+         CloseHandle(file);
+         throw failed_to_map_file{"Error: Cannot get the size of file: " + path.string()};
+      }
+
+      if (size.QuadPart > 0)
+      {
+         // The view keeps the mapping alive; we don't need the handles
+         // once it is mapped.
+         HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+         if (mapping)
+         {
+            _data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+         }
+         if (!_data)
+         {
+            CloseHandle(file);
+            throw failed_to_map_file{"Error: Cannot map file: " + path.string()};
+         }
+         _size = std::size_t(size.QuadPart);
+      }
+      CloseHandle(file);
+   }
+
+   void mapped_file::unmap()
+   {
+      if (_data)
+         UnmapViewOfFile(_data);
+      _data = nullptr;
+      _size = 0;
+   }
+
+#else
+
+   mapped_file::mapped_file(fs::path const& path)
+   {
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd == -1)
+         throw failed_to_map_file{"Error: Cannot open file: " + path.string()};
+
+      struct stat st;
+      if (::fstat(fd, &st) == -1)
+      {
+         ::close(fd);
+         throw failed_to_map_file{"Error: Cannot get the size of file: " + path.string()};
+      }
+
+      if (st.st_size > 0)
+      {
+         // The mapping stays valid after the file is closed
+         auto p = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+         if (p == MAP_FAILED)
+         {
+            ::close(fd);
+            throw failed_to_map_file{"Error: Cannot map file: " + path.string()};
+         }
+         _data = p;
+         _size = std::size_t(st.st_size);
+      }
+      ::close(fd);
+   }
+
+   void mapped_file::unmap()
+   {
+      if (_data)
+         ::munmap(const_cast<void*>(_data), _size);
+      _data = nullptr;
+      _size = 0;
+   }
+
+#endif
+
+   mapped_file::mapped_file(mapped_file&& rhs)
+    : _data{std::exchange(rhs._data, nullptr)}
+    , _size{std::exchange(rhs._size, 0)}
+   {}
+
+   mapped_file::~mapped_file()
+   {
+      unmap();
+   }
+
+   mapped_file& mapped_file::operator=(mapped_file&& rhs)
+   {
+      if (this != &rhs)
+      {
+         unmap();
+         _data = std::exchange(rhs._data, nullptr);
+         _size = std::exchange(rhs._size, 0);
+      }
+      return *this;
+   }
+}
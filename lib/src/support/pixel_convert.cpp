@@ -0,0 +1,668 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/detail/pixel_convert.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+# define ELEMENTS_PIXEL_CONVERT_X86
+# include <immintrin.h>
+# if defined(_MSC_VER) && !defined(__clang__)
+#  include <intrin.h>
+# endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && !defined(__AARCH64EB__)
+# define ELEMENTS_PIXEL_CONVERT_NEON
+# include <arm_neon.h>
+#endif
+
+#if defined(ELEMENTS_PIXEL_CONVERT_X86) && !defined(_MSC_VER)
+# define ELEMENTS_TARGET_AVX2 __attribute__((target("avx2")))
+# define ELEMENTS_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+# define ELEMENTS_TARGET_AVX2
+# define ELEMENTS_TARGET_SSE2
+#endif
+
+namespace cycfi::elements::detail
+{
+   namespace
+   {
+      using row_kernel = void(*)(std::uint8_t const* src, std::uint8_t* dest, std::size_t width);
+
+      // Averages the 2 x 2 blocks of rows `src0` and `src1` into `width`
+      // destination pixels. Both rows have at least `width * 2` pixels.
+      using half_row_kernel = void(*)(
+         std::uint8_t const* src0, std::uint8_t const* src1
+       , std::uint8_t* dest, std::size_t width
+      );
+
+      // The box blur kernels. `blur_row` filters one row of pixels from
+      // `src` into `dest` with a running sum. The column pass keeps a
+      // running sum per channel in `sums`, `n` of them, adding and
+      // subtracting whole rows as the box moves down, and `scale_row`
+      // turns the sums back into pixels. Sums are scaled by `inv`, the
+      // reciprocal of the box width, in single precision, and rounded to
+      // the nearest even, so that all kernels give the same results.
+      using blur_row_kernel = void(*)(
+         std::uint8_t const* src, std::uint8_t* dest
+       , std::size_t width, std::size_t radius, float inv
+      );
+
+      using sum_row_kernel = void(*)(std::int32_t* sums, std::uint8_t const* row, std::size_t n);
+      using scale_row_kernel = void(*)(std::int32_t const* sums, std::uint8_t* dest, std::size_t n, float inv);
+
+      // c * a / 255, rounded to the nearest. Exact for all 8-bit c and a.
+      // The vector kernels do the same in 16-bit lanes.
+      inline std::uint32_t premultiply(std::uint32_t c, std::uint32_t a)
+      {
+         auto t = (c * a) + 128;
+         return (t + (t >> 8)) >> 8;
+      }
+
+      void scalar_row(std::uint8_t const* src, std::uint8_t* dest, std::size_t width)
+      {
+         for (std::size_t x = 0; x != width; ++x, src += 4, dest += 4)
+         {
+            std::uint32_t a = src[3];
+            std::uint32_t pixel =
+                 (a << 24)
+               | (premultiply(src[0], a) << 16)
+               | (premultiply(src[1], a) << 8)
+               | premultiply(src[2], a)
+               ;
+            // Cairo's pixels are native endian 32-bit words
+            std::memcpy(dest, &pixel, sizeof(pixel));
+         }
+      }
+
+      void scalar_half_row(
+         std::uint8_t const* src0, std::uint8_t const* src1
+       , std::uint8_t* dest, std::size_t width
+      )
+      {
+         for (std::size_t x = 0; x != width; ++x, src0 += 8, src1 += 8, dest += 4)
+         {
+            for (int c = 0; c != 4; ++c)
+               dest[c] = (src0[c] + src0[c+4] + src1[c] + src1[c+4] + 2) >> 2;
+         }
+      }
+
+      void scalar_blur_row(
+         std::uint8_t const* src, std::uint8_t* dest
+       , std::size_t width, std::size_t radius, float inv
+      )
+      {
+         std::int32_t sum[4] = {0, 0, 0, 0};
+         for (std::size_t x = 0; x != std::min(radius + 1, width); ++x)
+         {
+            for (int c = 0; c != 4; ++c)
+               sum[c] += src[(x * 4) + c];
+         }
+
+         for (std::size_t x = 0; x != width; ++x, dest += 4)
+         {
+            for (int c = 0; c != 4; ++c)
+               dest[c] = std::uint8_t(std::lrint(float(sum[c]) * inv));
+            if (x + radius + 1 < width)
+            {
+               for (int c = 0; c != 4; ++c)
+                  sum[c] += src[((x + radius + 1) * 4) + c];
+            }
+            if (x >= radius)
+            {
+               for (int c = 0; c != 4; ++c)
+                  sum[c] -= src[((x - radius) * 4) + c];
+            }
+         }
+      }
+
+      void scalar_add_row(std::int32_t* sums, std::uint8_t const* row, std::size_t n)
+      {
+         for (std::size_t i = 0; i != n; ++i)
+            sums[i] += row[i];
+      }
+
+      void scalar_sub_row(std::int32_t* sums, std::uint8_t const* row, std::size_t n)
+      {
+         for (std::size_t i = 0; i != n; ++i)
+            sums[i] -= row[i];
+      }
+
+      void scalar_scale_row(std::int32_t const* sums, std::uint8_t* dest, std::size_t n, float inv)
+      {
+         for (std::size_t i = 0; i != n; ++i)
+            dest[i] = std::uint8_t(std::lrint(float(sums[i]) * inv));
+      }
+
+#if defined(ELEMENTS_PIXEL_CONVERT_X86)
+
+      // The vector kernels work on pixels widened to 16-bit lanes:
+      // r g b a | r g b a. They swap red and blue, multiply every lane by
+      // its pixel's alpha, and put the original alpha back.
+
+      ELEMENTS_TARGET_SSE2
+      inline __m128i premultiply_sse2(__m128i px, __m128i alpha_mask)
+      {
+         auto a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+         auto t = _mm_add_epi16(_mm_mullo_epi16(px, a), _mm_set1_epi16(128));
+         t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+         t = _mm_or_si128(_mm_andnot_si128(alpha_mask, t), _mm_and_si128(alpha_mask, px));
+         return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+      }
+
+      ELEMENTS_TARGET_SSE2
+      void sse2_row(std::uint8_t const* src, std::uint8_t* dest, std::size_t width)
+      {
+         auto const zero = _mm_setzero_si128();
+         auto const alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+         std::size_t x = 0;
+         for (; x + 4 <= width; x += 4, src += 16, dest += 16)
+         {
+            auto px = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));
+            auto lo = premultiply_sse2(_mm_unpacklo_epi8(px, zero), alpha_mask);
+            auto hi = premultiply_sse2(_mm_unpackhi_epi8(px, zero), alpha_mask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(lo, hi));
+         }
+         scalar_row(src, dest, width - x);
+      }
+
+      ELEMENTS_TARGET_SSE2
+      inline __m128i half_sse2(__m128i row0, __m128i row1, __m128i zero)
+      {
+         // Two pixels from each row, widened and summed vertically, then
+         // horizontally: the sum of one 2 x 2 block in the low four lanes
+         auto lo = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+         auto hi = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+         auto sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+         return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+      }
+
+      ELEMENTS_TARGET_SSE2
+      void sse2_half_row(
+         std::uint8_t const* src0, std::uint8_t const* src1
+       , std::uint8_t* dest, std::size_t width
+      )
+      {
+         auto const zero = _mm_setzero_si128();
+
+         std::size_t x = 0;
+         for (; x + 4 <= width; x += 4, src0 += 32, src1 += 32, dest += 16)
+         {
+            auto a0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src0));
+            auto b0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src0 + 16));
+            auto a1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src1));
+            auto b1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src1 + 16));
+            auto lo = half_sse2(a0, a1, zero);
+            auto hi = half_sse2(b0, b1, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(lo, hi));
+         }
+         scalar_half_row(src0, src1, dest, width - x);
+      }
+
+      // The blur kernels widen to 32-bit lanes: a pixel per register in
+      // the row pass, 16 channels in four registers in the column pass.
+
+      ELEMENTS_TARGET_SSE2
+      inline __m128i load_pixel_sse2(std::uint8_t const* p, __m128i zero)
+      {
+         std::int32_t px;
+         std::memcpy(&px, p, sizeof(px));
+         return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero), zero);
+      }
+
+      ELEMENTS_TARGET_SSE2
+      void sse2_blur_row(
+         std::uint8_t const* src, std::uint8_t* dest
+       , std::size_t width, std::size_t radius, float inv
+      )
+      {
+         auto const zero = _mm_setzero_si128();
+         auto const scale = _mm_set1_ps(inv);
+
+         auto sum = zero;
+         for (std::size_t x = 0; x != std::min(radius + 1, width); ++x)
+            sum = _mm_add_epi32(sum, load_pixel_sse2(src + (x * 4), zero));
+
+         for (std::size_t x = 0; x != width; ++x, dest += 4)
+         {
+            auto v = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), scale));
+            v = _mm_packus_epi16(_mm_packs_epi32(v, zero), zero);
+            auto px = _mm_cvtsi128_si32(v);
+            std::memcpy(dest, &px, sizeof(px));
+
+            if (x + radius + 1 < width)
+               sum = _mm_add_epi32(sum, load_pixel_sse2(src + ((x + radius + 1) * 4), zero));
+            if (x >= radius)
+               sum = _mm_sub_epi32(sum, load_pixel_sse2(src + ((x - radius) * 4), zero));
+         }
+      }
+
+      template <bool add>
+      ELEMENTS_TARGET_SSE2
+      void sse2_sum_row(std::int32_t* sums, std::uint8_t const* row, std::size_t n)
+      {
+         auto const zero = _mm_setzero_si128();
+
+         std::size_t i = 0;
+         for (; i + 16 <= n; i += 16, row += 16, sums += 16)
+         {
+            auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row));
+            auto lo = _mm_unpacklo_epi8(v, zero);
+            auto hi = _mm_unpackhi_epi8(v, zero);
+            __m128i w[4] = {
+               _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero)
+             , _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+            };
+            for (int j = 0; j != 4; ++j)
+            {
+               auto p = reinterpret_cast<__m128i*>(sums + (j * 4));
+               auto v = _mm_loadu_si128(p);
+               _mm_storeu_si128(p, add? _mm_add_epi32(v, w[j]) : _mm_sub_epi32(v, w[j]));
+            }
+         }
+         if (add)
+            scalar_add_row(sums, row, n - i);
+         else
+            scalar_sub_row(sums, row, n - i);
+      }
+
+      ELEMENTS_TARGET_SSE2
+      inline __m128i scale_sse2(std::int32_t const* p, __m128 scale)
+      {
+         auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+         return _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+      }
+
+      ELEMENTS_TARGET_SSE2
+      void sse2_scale_row(std::int32_t const* sums, std::uint8_t* dest, std::size_t n, float inv)
+      {
+         auto const scale = _mm_set1_ps(inv);
+
+         std::size_t i = 0;
+         for (; i + 16 <= n; i += 16, sums += 16, dest += 16)
+         {
+            auto lo = _mm_packs_epi32(scale_sse2(sums, scale), scale_sse2(sums + 4, scale));
+            auto hi = _mm_packs_epi32(scale_sse2(sums + 8, scale), scale_sse2(sums + 12, scale));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(lo, hi));
+         }
+         scalar_scale_row(sums, dest, n - i, inv);
+      }
+
+      ELEMENTS_TARGET_AVX2
+      inline __m256i premultiply_avx2(__m256i px, __m256i alpha_mask)
+      {
+         auto a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+         auto t = _mm256_add_epi16(_mm256_mullo_epi16(px, a), _mm256_set1_epi16(128));
+         t = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+         t = _mm256_blendv_epi8(t, px, alpha_mask);
+         return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+      }
+
+      ELEMENTS_TARGET_AVX2
+      void avx2_row(std::uint8_t const* src, std::uint8_t* dest, std::size_t width)
+      {
+         auto const zero = _mm256_setzero_si256();
+         auto const alpha_mask = _mm256_set_epi16(
+            -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0
+         );
+
+         // Unpacking and packing both work within 128-bit lanes, so the
+         // pixels come out in the order they went in.
+         std::size_t x = 0;
+         for (; x + 8 <= width; x += 8, src += 32, dest += 32)
+         {
+            auto px = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+            auto lo = premultiply_avx2(_mm256_unpacklo_epi8(px, zero), alpha_mask);
+            auto hi = premultiply_avx2(_mm256_unpackhi_epi8(px, zero), alpha_mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm256_packus_epi16(lo, hi));
+         }
+         sse2_row(src, dest, width - x);
+      }
+
+      bool has_avx2()
+      {
+# if defined(_MSC_VER) && !defined(__clang__)
+         int info[4];
+         __cpuid(info, 0);
+         if (info[0] < 7)
+            return false;
+         __cpuid(info, 1);
+         bool osxsave = (info[2] & (1 << 27)) != 0;
+         bool avx = (info[2] & (1 << 28)) != 0;
+         if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+         __cpuidex(info, 7, 0);
+         return (info[1] & (1 << 5)) != 0;
+# else
+         return __builtin_cpu_supports("avx2");
+# endif
+      }
+
+      bool has_sse2()
+      {
+# if defined(__x86_64__) || defined(_M_X64)
+         return true;
+# elif defined(_MSC_VER) && !defined(__clang__)
+         int info[4];
+         __cpuid(info, 1);
+         return (info[3] & (1 << 26)) != 0;
+# else
+         return __builtin_cpu_supports("sse2");
+# endif
+      }
+
+#elif defined(ELEMENTS_PIXEL_CONVERT_NEON)
+
+      inline uint8x16_t premultiply_neon(uint8x16_t c, uint8x16_t a)
+      {
+         // (t + ((t + 128) >> 8) + 128) >> 8, the same as premultiply
+         auto lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+         auto hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+         return vcombine_u8(
+            vraddhn_u16(lo, vrshrq_n_u16(lo, 8))
+          , vraddhn_u16(hi, vrshrq_n_u16(hi, 8))
+         );
+      }
+
+      void neon_half_row(
+         std::uint8_t const* src0, std::uint8_t const* src1
+       , std::uint8_t* dest, std::size_t width
+      )
+      {
+         std::size_t x = 0;
+         for (; x + 4 <= width; x += 4, src0 += 32, src1 += 32, dest += 16)
+         {
+            // Even and odd pixels, four of each, from both rows
+            auto r0 = vld2q_u32(reinterpret_cast<std::uint32_t const*>(src0));
+            auto r1 = vld2q_u32(reinterpret_cast<std::uint32_t const*>(src1));
+            auto e0 = vreinterpretq_u8_u32(r0.val[0]);
+            auto o0 = vreinterpretq_u8_u32(r0.val[1]);
+            auto e1 = vreinterpretq_u8_u32(r1.val[0]);
+            auto o1 = vreinterpretq_u8_u32(r1.val[1]);
+            auto lo = vaddq_u16(
+               vaddl_u8(vget_low_u8(e0), vget_low_u8(o0))
+             , vaddl_u8(vget_low_u8(e1), vget_low_u8(o1))
+            );
+            auto hi = vaddq_u16(
+               vaddl_u8(vget_high_u8(e0), vget_high_u8(o0))
+             , vaddl_u8(vget_high_u8(e1), vget_high_u8(o1))
+            );
+            vst1q_u8(dest, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+         }
+         scalar_half_row(src0, src1, dest, width - x);
+      }
+
+      inline int32x4_t load_pixel_neon(std::uint8_t const* p)
+      {
+         std::uint32_t px;
+         std::memcpy(&px, p, sizeof(px));
+         auto v = vmovl_u8(vcreate_u8(px));
+         return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v)));
+      }
+
+      void neon_blur_row(
+         std::uint8_t const* src, std::uint8_t* dest
+       , std::size_t width, std::size_t radius, float inv
+      )
+      {
+         auto sum = vdupq_n_s32(0);
+         for (std::size_t x = 0; x != std::min(radius + 1, width); ++x)
+            sum = vaddq_s32(sum, load_pixel_neon(src + (x * 4)));
+
+         for (std::size_t x = 0; x != width; ++x, dest += 4)
+         {
+            auto v = vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(sum), inv));
+            auto b = vqmovun_s16(vcombine_s16(vqmovn_s32(v), vdup_n_s16(0)));
+            auto px = vget_lane_u32(vreinterpret_u32_u8(b), 0);
+            std::memcpy(dest, &px, sizeof(px));
+
+            if (x + radius + 1 < width)
+               sum = vaddq_s32(sum, load_pixel_neon(src + ((x + radius + 1) * 4)));
+            if (x >= radius)
+               sum = vsubq_s32(sum, load_pixel_neon(src + ((x - radius) * 4)));
+         }
+      }
+
+      template <bool add>
+      void neon_sum_row(std::int32_t* sums, std::uint8_t const* row, std::size_t n)
+      {
+         std::size_t i = 0;
+         for (; i + 16 <= n; i += 16, row += 16, sums += 16)
+         {
+            auto v = vld1q_u8(row);
+            auto lo = vmovl_u8(vget_low_u8(v));
+            auto hi = vmovl_u8(vget_high_u8(v));
+            uint32x4_t w[4] = {
+               vmovl_u16(vget_low_u16(lo)), vmovl_u16(vget_high_u16(lo))
+             , vmovl_u16(vget_low_u16(hi)), vmovl_u16(vget_high_u16(hi))
+            };
+            for (int j = 0; j != 4; ++j)
+            {
+               auto s = vld1q_s32(sums + (j * 4));
+               auto x = vreinterpretq_s32_u32(w[j]);
+               vst1q_s32(sums + (j * 4), add? vaddq_s32(s, x) : vsubq_s32(s, x));
+            }
+         }
+         if (add)
+            scalar_add_row(sums, row, n - i);
+         else
+            scalar_sub_row(sums, row, n - i);
+      }
+
+      void neon_scale_row(std::int32_t const* sums, std::uint8_t* dest, std::size_t n, float inv)
+      {
+         auto to_int = [inv](std::int32_t const* p)
+         {
+            return vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(p)), inv)));
+         };
+
+         std::size_t i = 0;
+         for (; i + 16 <= n; i += 16, sums += 16, dest += 16)
+         {
+            auto lo = vcombine_s16(to_int(sums), to_int(sums + 4));
+            auto hi = vcombine_s16(to_int(sums + 8), to_int(sums + 12));
+            vst1q_u8(dest, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+         }
+         scalar_scale_row(sums, dest, n - i, inv);
+      }
+
+      void neon_row(std::uint8_t const* src, std::uint8_t* dest, std::size_t width)
+      {
+         std::size_t x = 0;
+         for (; x + 16 <= width; x += 16, src += 64, dest += 64)
+         {
+            auto px = vld4q_u8(src);
+            uint8x16x4_t out;
+            out.val[0] = premultiply_neon(px.val[2], px.val[3]);  // blue
+            out.val[1] = premultiply_neon(px.val[1], px.val[3]);  // green
+            out.val[2] = premultiply_neon(px.val[0], px.val[3]);  // red
+            out.val[3] = px.val[3];                               // alpha
+            vst4q_u8(dest, out);
+         }
+         scalar_row(src, dest, width - x);
+      }
+
+#endif
+
+      struct kernel
+      {
+         row_kernel        row;
+         half_row_kernel   half_row;
+         blur_row_kernel   blur_row;
+         sum_row_kernel    add_row;
+         sum_row_kernel    sub_row;
+         scale_row_kernel  scale_row;
+         char const*       name;
+      };
+
+      kernel select_kernel()
+      {
+#if defined(ELEMENTS_PIXEL_CONVERT_X86)
+         if (has_avx2())
+         {
+            return {
+               avx2_row, sse2_half_row
+             , sse2_blur_row, sse2_sum_row<true>, sse2_sum_row<false>, sse2_scale_row
+             , "avx2"
+            };
+         }
+         if (has_sse2())
+         {
+            return {
+               sse2_row, sse2_half_row
+             , sse2_blur_row, sse2_sum_row<true>, sse2_sum_row<false>, sse2_scale_row
+             , "sse2"
+            };
+         }
+#elif defined(ELEMENTS_PIXEL_CONVERT_NEON)
+         return {
+            neon_row, neon_half_row
+          , neon_blur_row, neon_sum_row<true>, neon_sum_row<false>, neon_scale_row
+          , "neon"
+         };
+#endif
+         return {
+            scalar_row, scalar_half_row
+          , scalar_blur_row, scalar_add_row, scalar_sub_row, scalar_scale_row
+          , "scalar"
+         };
+      }
+
+      // One box blur pass along the rows, from `data` into `temp`, and one
+      // along the columns, back into `data`
+      void box_blur(
+         kernel const& k
+       , std::uint8_t* data, std::size_t stride
+       , std::size_t width, std::size_t height
+       , std::size_t radius
+       , std::vector<std::uint8_t>& temp
+       , std::vector<std::int32_t>& sums
+      )
+      {
+         auto row_bytes = width * 4;
+         auto inv = 1.0f / float((2 * radius) + 1);
+         temp.resize(row_bytes * height);
+         sums.assign(row_bytes, 0);
+
+         for (std::size_t y = 0; y != height; ++y)
+            k.blur_row(data + (y * stride), temp.data() + (y * row_bytes), width, radius, inv);
+
+         auto row = [&](std::size_t y) { return temp.data() + (y * row_bytes); };
+         for (std::size_t y = 0; y != std::min(radius + 1, height); ++y)
+            k.add_row(sums.data(), row(y), row_bytes);
+
+         for (std::size_t y = 0; y != height; ++y)
+         {
+            k.scale_row(sums.data(), data + (y * stride), row_bytes, inv);
+            if (y + radius + 1 < height)
+               k.add_row(sums.data(), row(y + radius + 1), row_bytes);
+            if (y >= radius)
+               k.sub_row(sums.data(), row(y - radius), row_bytes);
+         }
+      }
+
+      kernel const& get_kernel()
+      {
+         static kernel const k = select_kernel();
+         return k;
+      }
+   }
+
+   void rgba_to_premultiplied_argb(
+      std::uint8_t const* src, std::size_t src_stride
+    , std::uint8_t* dest, std::size_t dest_stride
+    , std::size_t width, std::size_t height
+   )
+   {
+      auto row = get_kernel().row;
+      for (std::size_t y = 0; y != height; ++y)
+         row(src + (y * src_stride), dest + (y * dest_stride), width);
+   }
+
+   void downsample_half(
+      std::uint8_t const* src, std::size_t src_stride
+    , std::size_t width, std::size_t height
+    , std::uint8_t* dest, std::size_t dest_stride
+   )
+   {
+      auto half_row = get_kernel().half_row;
+      auto dest_width = std::max<std::size_t>(width / 2, 1);
+      auto dest_height = std::max<std::size_t>(height / 2, 1);
+
+      // A single row or column is averaged with itself. The kernels read
+      // two source pixels per destination pixel, so a single column is
+      // copied out doubled, a row at a time.
+      std::uint8_t doubled[16];
+
+      for (std::size_t y = 0; y != dest_height; ++y)
+      {
+         auto src0 = src + ((2 * y) * src_stride);
+         auto src1 = (height > 1)? src0 + src_stride : src0;
+         if (width == 1)
+         {
+            std::memcpy(doubled, src0, 4);
+            std::memcpy(doubled + 4, src0, 4);
+            std::memcpy(doubled + 8, src1, 4);
+            std::memcpy(doubled + 12, src1, 4);
+            src0 = doubled;
+            src1 = doubled + 8;
+         }
+         half_row(src0, src1, dest + (y * dest_stride), dest_width);
+      }
+   }
+
+   void box_blur(
+      std::uint8_t* data, std::size_t stride
+    , std::size_t width, std::size_t height
+    , std::size_t radius
+   )
+   {
+      if (radius == 0 || width == 0 || height == 0)
+         return;
+
+      std::vector<std::uint8_t> temp;
+      std::vector<std::int32_t> sums;
+      box_blur(get_kernel(), data, stride, width, height, radius, temp, sums);
+   }
+
+   void gaussian_blur(
+      std::uint8_t* data, std::size_t stride
+    , std::size_t width, std::size_t height
+    , float sigma
+   )
+   {
+      if (sigma <= 0 || width == 0 || height == 0)
+         return;
+
+      // The three box widths whose combined variance is closest to
+      // sigma squared: `m` boxes `wl` wide, and the rest `wl + 2` wide.
+      // See "Fast Almost-Gaussian Filtering" by Peter Kovesi.
+      constexpr int n = 3;
+      auto var = double(sigma) * sigma;
+      auto wl = int(std::floor(std::sqrt((12 * var / n) + 1)));
+      if (wl % 2 == 0)
+         --wl;
+      auto m = std::lround(((12 * var) - (n * wl * wl) - (4 * n * wl) - (3 * n)) / ((-4 * wl) - 4));
+
+      std::vector<std::uint8_t> temp;
+      std::vector<std::int32_t> sums;
+      auto const& k = get_kernel();
+      for (int i = 0; i != n; ++i)
+      {
+         auto radius = std::size_t(((i < m)? wl : wl + 2) - 1) / 2;
+         if (radius > 0)
+            box_blur(k, data, stride, width, height, radius, temp, sums);
+      }
+   }
+
+   char const* pixel_convert_kernel()
+   {
+      return get_kernel().name;
+   }
+}
@@ -5,17 +5,233 @@
 =============================================================================*/
 #include <elements/support/pixmap.hpp>
 #include <elements/support/resource_paths.hpp>
+#include <elements/support/mapped_file.hpp>
+#include <elements/support/detail/pixel_convert.hpp>
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_PNG 1
 #include <webp/decode.h>
 #include <elements/support/detail/stb_image.h>
 #include <infra/assert.hpp>
 #include <infra/filesystem.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <list>
+#include <mutex>
 #include <string>
-#include <fstream>
 
 namespace cycfi { namespace elements
 {
+   namespace
+   {
+      struct png_reader
+      {
+         uint8_t const*    data;
+         std::size_t       remaining;
+      };
+
+      cairo_status_t read_png(void* closure, unsigned char* data, unsigned int length)
+      {
+         auto& reader = *static_cast<png_reader*>(closure);
+         if (length > reader.remaining)
+            return CAIRO_STATUS_READ_ERROR;
+         std::memcpy(data, reader.data, length);
+         reader.data += length;
+         reader.remaining -= length;
+         return CAIRO_STATUS_SUCCESS;
+      }
+
+      // The decoders give us straight RGBA. Cairo wants premultiplied,
+      // native endian ARGB.
+      cairo_surface_t* surface_from_rgba(uint8_t const* src, std::size_t src_stride, int w, int h)
+      {
+         auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+         if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+         {
+            cairo_surface_destroy(surface);
+            return nullptr;
+         }
+
+         uint8_t* dest_data = cairo_image_surface_get_data(surface);
+         size_t   dest_stride = cairo_image_surface_get_stride(surface);
+         if (dest_data)
+            detail::rgba_to_premultiplied_argb(src, src_stride, dest_data, dest_stride, w, h);
+         return surface;
+      }
+
+      mapped_file map_image(fs::path const& path)
+      {
+         if (path.extension().empty())
+            throw failed_to_load_pixmap{"Unknown file type."};
+
+         fs::path full_path = find_file(path);
+         if (full_path.empty())
+            throw failed_to_load_pixmap{"File does not exist."};
+
+         try
+         {
+            return mapped_file{full_path};
+         }
+         catch (failed_to_map_file const&)
+         {
+            throw failed_to_load_pixmap{"Failed to open file: " + path.string()};
+         }
+      }
+
+      // Decode an image, with the decoder for its file extension. Returns
+      // null if it can't be decoded.
+      cairo_surface_t* decode(uint8_t const* data, std::size_t size, fs::path const& ext)
+      {
+         if (ext == ".png" || ext == ".PNG")
+         {
+            // For PNGs, use Cairo's native PNG loader, reading from memory
+            png_reader reader{data, size};
+            auto surface = cairo_image_surface_create_from_png_stream(read_png, &reader);
+            if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+            {
+               cairo_surface_destroy(surface);
+               return nullptr;
+            }
+            return surface;
+         }
+
+         uint8_t* src_data = nullptr;
+         int w, h;
+         if (ext == ".webp" || ext == ".WEBP")
+         {
+            src_data = WebPDecodeRGBA(data, size, &w, &h);
+         }
+         else if (size <= INT_MAX)
+         {
+            // For everything else, use stb_image
+            int components;
+            src_data = stbi_load_from_memory(data, int(size), &w, &h, &components, 4);
+         }
+         if (!src_data)
+            return nullptr;
+
+         auto surface = surface_from_rgba(src_data, std::size_t(w) * 4, w, h);
+         free(src_data);
+         return surface;
+      }
+
+      // Get the size of an image in pixels, from its header, without
+      // decoding it
+      bool image_size(uint8_t const* data, std::size_t size, fs::path const& ext, int& w, int& h)
+      {
+         if (ext == ".png" || ext == ".PNG")
+         {
+            // The IHDR chunk comes first, right after the signature
+            static constexpr uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+            if (size < 24
+               || std::memcmp(data, signature, sizeof(signature)) != 0
+               || std::memcmp(data + 12, "IHDR", 4) != 0)
+            {
+               return false;
+            }
+            auto be32 = [](uint8_t const* p)
+            {
+               return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+            };
+            auto pw = be32(data + 16);
+            auto ph = be32(data + 20);
+            if (pw == 0 || ph == 0 || pw > INT_MAX || ph > INT_MAX)
+               return false;
+            w = int(pw);
+            h = int(ph);
+            return true;
+         }
+         if (ext == ".webp" || ext == ".WEBP")
+            return WebPGetInfo(data, size, &w, &h);
+
+         int components;
+         return size <= INT_MAX && stbi_info_from_memory(data, int(size), &w, &h, &components);
+      }
+   }
+
+   ////////////////////////////////////////////////////////////////////////////
+   // Compressed pixmaps
+   ////////////////////////////////////////////////////////////////////////////
+   struct pixmap::compressed_data
+   {
+      using lru_list = std::list<compressed_data*>;
+
+      // All the compressed pixmaps, and the decoded ones in the order they
+      // were last drawn
+      struct registry
+      {
+         std::mutex           mutex;
+         lru_list             lru;              // Most recently drawn first
+         std::size_t          pixmaps = 0;
+         std::size_t          encoded_bytes = 0;
+         std::size_t          resident_bytes = 0;
+         std::size_t          budget = default_compressed_budget;
+
+         void                 trim();
+      };
+
+      static registry&        get_registry();
+
+      std::vector<uint8_t>    encoded;
+      fs::path                ext;              // Selects the decoder
+      int                     width;            // Pixels
+      int                     height;
+      float                   scale;
+      pixmap const*           owner;
+      lru_list::iterator      pos;              // Valid if resident
+      bool                    resident = false;
+      std::size_t             bytes = 0;        // Counted in resident_bytes
+   };
+
+   // Never destroyed, as pixmaps may outlive static destruction
+   pixmap::compressed_data::registry& pixmap::compressed_data::get_registry()
+   {
+      static auto r = new registry;
+      return *r;
+   }
+
+   // Evict the least recently drawn pixmaps until we're within the budget.
+   // The most recently drawn one stays, even if it is over the budget by
+   // itself. Call with the mutex locked.
+   void pixmap::compressed_data::registry::trim()
+   {
+      while (resident_bytes > budget && lru.size() > 1)
+      {
+         auto c = lru.back();
+         lru.pop_back();
+         resident_bytes -= c->bytes;
+         c->resident = false;
+         c->bytes = 0;
+         c->owner->evict();
+      }
+   }
+
+   compressed_pixmap_statistics compressed_pixmap_stats()
+   {
+      auto& r = pixmap::compressed_data::get_registry();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      compressed_pixmap_statistics stats;
+      stats.pixmaps = r.pixmaps;
+      stats.resident = r.lru.size();
+      stats.resident_bytes = r.resident_bytes;
+      stats.encoded_bytes = r.encoded_bytes;
+      stats.budget = r.budget;
+      return stats;
+   }
+
+   /**
+    * \brief
+    *    Set the most pixel memory that compressed pixmaps may use when
+    *    decoded. The default is `pixmap::default_compressed_budget`.
+    */
+   void compressed_pixmap_budget(std::size_t bytes)
+   {
+      auto& r = pixmap::compressed_data::get_registry();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      r.budget = bytes;
+      r.trim();
+   }
+
    pixmap::pixmap(point size, float scale)
     : _surface(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size.x, size.y))
    {
@@ -27,95 +243,310 @@ namespace cycfi { namespace elements
       cairo_surface_mark_dirty(_surface);
    }
 
-   pixmap::pixmap(fs::path const& path, float scale)
+   pixmap::pixmap(fs::path const& path, float scale, pixmap_storage storage)
     : _surface(nullptr)
    {
+      auto file = map_image(path);
+      auto data = reinterpret_cast<uint8_t const*>(file.data());
       auto ext = path.extension();
-      if (ext.empty())
-         throw failed_to_load_pixmap{"Unknown file type."};
 
-      fs::path full_path = find_file(path);
-      if (full_path.empty())
-         throw failed_to_load_pixmap{"File does not exist."};
+      if (storage == pixmap_storage::compressed)
+      {
+         // Keep a copy of the encoded bytes, not the mapping: the file may
+         // change or go away while we hold it.
+         int w, h;
+         if (!image_size(data, file.size(), ext, w, h))
+            throw failed_to_load_pixmap{"Failed to load pixmap."};
+
+         _compressed = std::make_unique<compressed_data>();
+         _compressed->encoded.assign(data, data + file.size());
+         _compressed->ext = ext;
+         _compressed->width = w;
+         _compressed->height = h;
+         _compressed->scale = scale;
+         _compressed->owner = this;
+
+         auto& r = compressed_data::get_registry();
+         std::lock_guard<std::mutex> lock{r.mutex};
+         ++r.pixmaps;
+         r.encoded_bytes += file.size();
+         return;
+      }
+
+      _surface = decode(data, file.size(), ext);
+      if (!_surface)
+         throw failed_to_load_pixmap{"Failed to load pixmap."};
+
+      // Set scale and flag the surface as dirty
+      cairo_surface_set_device_scale(_surface, 1/scale, 1/scale);
+      cairo_surface_mark_dirty(_surface);
+   }
+
+   /**
+    * \brief
+    *    Make a pixmap from `size.x` by `size.y` pixels of straight
+    *    (not premultiplied) RGBA, `stride` bytes per row, e.g. a frame
+    *    from a decoder.
+    */
+   pixmap::pixmap(point size, uint8_t const* rgba, std::size_t stride, float scale)
+    : _surface(surface_from_rgba(rgba, stride, int(size.x), int(size.y)))
+   {
+      if (!_surface)
+         throw failed_to_load_pixmap{"Failed to create pixmap."};
+
+      // Set scale and flag the surface as dirty
+      cairo_surface_set_device_scale(_surface, 1/scale, 1/scale);
+      cairo_surface_mark_dirty(_surface);
+   }
 
-      uint8_t* src_data = nullptr;
-      int w, h;
+   pixmap::pixmap(pixmap&& rhs)
+    : _surface(rhs._surface)
+    , _mipmaps(std::move(rhs._mipmaps))
+   {
+      rhs._surface = nullptr;
+      rhs._mipmaps.clear();
+      if (rhs._compressed)
+      {
+         auto& r = compressed_data::get_registry();
+         std::lock_guard<std::mutex> lock{r.mutex};
+         _compressed = std::move(rhs._compressed);
+         _compressed->owner = this;
+      }
+   }
 
-      if (ext == ".png" || ext == ".PNG")
+   pixmap& pixmap::operator=(pixmap&& rhs)
+   {
+      if (this != &rhs)
       {
-         // For PNGs, use Cairo's native PNG loader
-         _surface = cairo_image_surface_create_from_png(full_path.string().c_str());
+         std::swap(_surface, rhs._surface);
+         std::swap(_mipmaps, rhs._mipmaps);
+         if (_compressed || rhs._compressed)
+         {
+            auto& r = compressed_data::get_registry();
+            std::lock_guard<std::mutex> lock{r.mutex};
+            std::swap(_compressed, rhs._compressed);
+            if (_compressed)
+               _compressed->owner = this;
+            if (rhs._compressed)
+               rhs._compressed->owner = &rhs;
+         }
       }
-      if (ext == ".webp" || ext == ".WEBP")
+      return *this;
+   }
+
+   pixmap::~pixmap()
+   {
+      if (_compressed)
       {
-         std::ifstream file(full_path.string().c_str(), std::ios::binary);
-         if (!file.is_open())
-            throw failed_to_load_pixmap{"Failed to open file: " + path.string()};
+         auto& r = compressed_data::get_registry();
+         std::lock_guard<std::mutex> lock{r.mutex};
+         if (_compressed->resident)
+         {
+            r.lru.erase(_compressed->pos);
+            r.resident_bytes -= _compressed->bytes;
+         }
+         --r.pixmaps;
+         r.encoded_bytes -= _compressed->encoded.size();
+      }
 
-         // Get file size
-         file.seekg(0, std::ios::end);
-         std::streamsize size = file.tellg();
-         file.seekg(0, std::ios::beg);
+      clear_mipmaps();
+      if (_surface)
+         cairo_surface_destroy(_surface);
+   }
+
+   /**
+    * \brief
+    *    Get the full size surface, decoding it first if the pixmap is
+    *    compressed and not resident. Returns null if it can't be decoded.
+    */
+   /**
+    * \brief
+    *    Copy `src` pixel for pixel, whatever its scale, with its top-left
+    *    at `pos`. Unlike drawing through a canvas, this never reads from
+    *    the mipmaps.
+    */
+   void pixmap_context::copy(pixmap const& src, point pos) const
+   {
+      auto surface = src.surface();
+      if (!surface)
+         return;
 
-         // Read file into memory
-         std::vector<uint8_t> data(size);
-         if (!file.read((char*)data.data(), size))
-            throw failed_to_load_pixmap{"Failed to read file: " + path.string()};
+      double ssx = 1, ssy = 1, dsx = 1, dsy = 1;
+      cairo_surface_get_device_scale(surface, &ssx, &ssy);
+      cairo_surface_get_device_scale(cairo_get_target(_context), &dsx, &dsy);
 
-         src_data = WebPDecodeRGBA(data.data(), size, &w, &h);
+      cairo_save(_context);
+      cairo_translate(_context, pos.x, pos.y);
+      cairo_scale(_context, ssx / dsx, ssy / dsy);
+      cairo_set_source_surface(_context, surface, 0, 0);
+      cairo_paint(_context);
+      cairo_restore(_context);
+   }
+
+   cairo_surface_t* pixmap::surface() const
+   {
+      if (!_surface && _compressed)
+      {
+         auto const& c = *_compressed;
+         _surface = decode(c.encoded.data(), c.encoded.size(), c.ext);
+         if (_surface)
+         {
+            cairo_surface_set_device_scale(_surface, 1/c.scale, 1/c.scale);
+            cairo_surface_mark_dirty(_surface);
+         }
+      }
+      return _surface;
+   }
+
+   // Mark a compressed pixmap as just drawn, and count its pixels
+   void pixmap::touch() const
+   {
+      auto& c = *_compressed;
+      auto& r = compressed_data::get_registry();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      if (c.resident)
+      {
+         r.lru.splice(r.lru.begin(), r.lru, c.pos);
+         r.resident_bytes -= c.bytes;
       }
       else
       {
-         // For everything else, use stb_image
-         int components;
-         src_data = stbi_load(full_path.string().c_str(), &w, &h, &components, 4);
+         c.pos = r.lru.insert(r.lru.begin(), &c);
+         c.resident = true;
       }
+      c.bytes = bytes();      // Mipmaps may have been added
+      r.resident_bytes += c.bytes;
+      r.trim();
+   }
 
-      if (src_data)
-      {
-         _surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+   // Free the pixels of a compressed pixmap. Called by the registry, with
+   // its mutex locked.
+   void pixmap::evict() const
+   {
+      clear_mipmaps();
+      if (_surface)
+         cairo_surface_destroy(_surface);
+      _surface = nullptr;
+   }
 
-         uint8_t* dest_data = cairo_image_surface_get_data(_surface);
-         size_t   src_stride = w * 4;
-         size_t   dest_stride = cairo_image_surface_get_stride(_surface);
+   // Turn a compressed pixmap into a decoded one, for drawing into
+   void pixmap::decompress()
+   {
+      if (!_compressed)
+         return;
+      if (!surface())
+         throw failed_to_load_pixmap{"Failed to load pixmap."};
 
-         for (int y = 0; y != h; ++y)
+      {
+         auto& r = compressed_data::get_registry();
+         std::lock_guard<std::mutex> lock{r.mutex};
+         if (_compressed->resident)
          {
-            uint8_t* src = src_data + (y * src_stride);
-            uint8_t* dest = dest_data + (y * dest_stride);
-            for (int x = 0; x != w; ++x)
-            {
-               // $$$ TODO: Deal with endian issues $$$
+            r.lru.erase(_compressed->pos);
+            r.resident_bytes -= _compressed->bytes;
+         }
+         --r.pixmaps;
+         r.encoded_bytes -= _compressed->encoded.size();
+      }
+      _compressed.reset();
+   }
 
-               dest[0] = src[2];    // blue
-               dest[1] = src[1];    // green
-               dest[2] = src[0];    // red
-               dest[3] = src[3];    // alpha
+   /**
+    * \brief
+    *    Get the surface to draw from, given `ratio`, the number of device
+    *    pixels per source pixel. When drawing at half the size or less, a
+    *    smaller, box filtered level is used: the smallest that still has
+    *    at least one pixel per device pixel. The levels are built the first
+    *    time they are needed, each from the one before, and are kept until
+    *    the pixmap is drawn into.
+    *
+    *    The levels have the same size in user space as the pixmap itself.
+    *
+    *    A compressed pixmap is decoded first, if it is not resident, and is
+    *    marked as just drawn.
+    */
+   cairo_surface_t* pixmap::mipmap(double ratio) const
+   {
+      auto result = get_mipmap(ratio);
+      if (_compressed && _surface)
+         touch();
+      return result;
+   }
 
-               src += 4;
-               dest += 4;
-            }
+   cairo_surface_t* pixmap::get_mipmap(double ratio) const
+   {
+      if (!surface())
+         return nullptr;
+
+      std::size_t level = 0;
+      while (ratio <= 0.5)
+      {
+         ratio *= 2;
+         ++level;
+      }
+      if (level == 0)
+         return _surface;
+
+      auto format = cairo_image_surface_get_format(_surface);
+      if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+         return _surface;
+
+      while (_mipmaps.size() < level)
+      {
+         auto prev = _mipmaps.empty()? _surface : _mipmaps.back();
+         auto w = cairo_image_surface_get_width(prev);
+         auto h = cairo_image_surface_get_height(prev);
+         if (w <= 1 && h <= 1)
+            break;
+
+         auto next = cairo_image_surface_create(
+            format, std::max(w / 2, 1), std::max(h / 2, 1)
+         );
+         auto dest = cairo_image_surface_get_data(next);
+         cairo_surface_flush(prev);
+         auto src = cairo_image_surface_get_data(prev);
+         if (!dest || !src)
+         {
+            cairo_surface_destroy(next);
+            break;
          }
 
-         free(src_data);
+         detail::downsample_half(
+            src, cairo_image_surface_get_stride(prev), w, h
+          , dest, cairo_image_surface_get_stride(next)
+         );
+         cairo_surface_mark_dirty(next);
+         _mipmaps.push_back(next);
       }
 
-      if (!_surface)
-         throw failed_to_load_pixmap{"Failed to load pixmap."};
+      if (_mipmaps.empty())
+         return _surface;
+      auto surface = _mipmaps[std::min(level, _mipmaps.size()) - 1];
 
-      // Set scale and flag the surface as dirty
-      cairo_surface_set_device_scale(_surface, 1/scale, 1/scale);
-      cairo_surface_mark_dirty(_surface);
+      // Scale the level to the size of the pixmap, which may have been
+      // rescaled since
+      double scx, scy;
+      cairo_surface_get_device_scale(_surface, &scx, &scy);
+      cairo_surface_set_device_scale(
+         surface
+       , scx * cairo_image_surface_get_width(surface) / cairo_image_surface_get_width(_surface)
+       , scy * cairo_image_surface_get_height(surface) / cairo_image_surface_get_height(_surface)
+      );
+      return surface;
    }
 
-   pixmap::~pixmap()
+   void pixmap::clear_mipmaps() const
    {
-      if (_surface)
-         cairo_surface_destroy(_surface);
+      for (auto surface : _mipmaps)
+         cairo_surface_destroy(surface);
+      _mipmaps.clear();
    }
 
    extent pixmap::size() const
    {
+      if (_compressed)
+         return {_compressed->width * _compressed->scale, _compressed->height * _compressed->scale};
+
       double scx, scy;
       cairo_surface_get_device_scale(_surface, &scx, &scy);
       return {
@@ -124,8 +555,35 @@ namespace cycfi { namespace elements
       };
    }
 
+   // The memory used by the pixels, including the mipmaps. Zero for a
+   // compressed pixmap that is not resident.
+   std::size_t pixmap::bytes() const
+   {
+      auto size = [](cairo_surface_t* surface)
+      {
+         return std::size_t(cairo_image_surface_get_stride(surface))
+            * cairo_image_surface_get_height(surface);
+      };
+
+      if (!_surface)
+         return 0;
+      auto total = size(_surface);
+      for (auto surface : _mipmaps)
+         total += size(surface);
+      return total;
+   }
+
+   // The memory used by the encoded image. Zero unless compressed.
+   std::size_t pixmap::encoded_bytes() const
+   {
+      return _compressed? _compressed->encoded.size() : 0;
+   }
+
    float pixmap::scale() const
    {
+      if (_compressed)
+         return _compressed->scale;
+
       double scx, scy;
       cairo_surface_get_device_scale(_surface, &scx, &scy);
       return float(1/scx);
@@ -133,6 +591,9 @@ namespace cycfi { namespace elements
 
    void pixmap::scale(float val)
    {
-      cairo_surface_set_device_scale(_surface, 1/val, 1/val);
+      if (_compressed)
+         _compressed->scale = val;
+      if (_surface)
+         cairo_surface_set_device_scale(_surface, 1/val, 1/val);
    }
 }}
@@ -0,0 +1,152 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/pixmap_cache.hpp>
+#include <elements/support/resource_paths.hpp>
+#include <system_error>
+#include <tuple>
+
+namespace cycfi::elements
+{
+   bool pixmap_cache::key::operator<(key const& rhs) const
+   {
+      return std::tie(path, scale, mtime) < std::tie(rhs.path, rhs.scale, rhs.mtime);
+   }
+
+   /**
+    * \brief
+    *    Make the key for `path` at `scale`. Returns false if the file does
+    *    not exist.
+    */
+   bool pixmap_cache::make_key(fs::path const& path, float scale, key& k)
+   {
+      auto full_path = find_file(path);
+      if (full_path.empty())
+         return false;
+
+      std::error_code ec;
+      auto canonical = fs::weakly_canonical(full_path, ec);
+      if (!ec)
+         full_path = canonical;
+      auto mtime = fs::last_write_time(full_path, ec);
+
+      k.path = full_path.generic_string();
+      k.scale = scale;
+      k.mtime = ec? -1 : std::int64_t(mtime.time_since_epoch().count());
+      return true;
+   }
+
+   /**
+    * \brief
+    *    Get the pixmap for `path` at `scale`, loading it if it is not in the
+    *    cache, or if it was changed or freed since.
+    */
+   pixmap_ptr pixmap_cache::get(fs::path const& path, float scale)
+   {
+      // Let the pixmap report files that don't exist
+      key k;
+      if (!make_key(path, scale, k))
+         return std::make_shared<pixmap>(path, scale);
+
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         if (auto i = _map.find(k); i != _map.end())
+         {
+            if (auto p = i->second.lock())
+            {
+               ++_hits;
+               return p;
+            }
+         }
+         ++_misses;
+      }
+
+      // Load outside the lock. If another thread beat us to it, use theirs.
+      auto p = std::make_shared<pixmap>(fs::path{k.path}, scale);
+
+      std::lock_guard<std::mutex> lock{_mutex};
+      auto& entry = _map[std::move(k)];
+      if (auto existing = entry.lock())
+         return existing;
+      entry = p;
+      return p;
+   }
+
+   /**
+    * \brief
+    *    Get the pixmap for `path` at `scale` only if it is already loaded
+    *    and up to date. Returns null otherwise. Never loads.
+    */
+   pixmap_ptr pixmap_cache::find(fs::path const& path, float scale)
+   {
+      key k;
+      if (!make_key(path, scale, k))
+         return {};
+
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (auto i = _map.find(k); i != _map.end())
+      {
+         if (auto p = i->second.lock())
+         {
+            ++_hits;
+            return p;
+         }
+      }
+      return {};
+   }
+
+   pixmap_cache::statistics pixmap_cache::stats() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      statistics r;
+      r.hits = _hits;
+      r.misses = _misses;
+      for (auto const& [k, wp] : _map)
+      {
+         if (auto p = wp.lock())
+         {
+            ++r.entries;
+            r.bytes += p->bytes();
+         }
+      }
+      return r;
+   }
+
+   void pixmap_cache::reset_stats()
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _hits = _misses = 0;
+   }
+
+   /**
+    * \brief
+    *    Drop the entries of pixmaps that are no longer used. Returns the
+    *    number of entries dropped.
+    */
+   std::size_t pixmap_cache::trim()
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      std::size_t n = 0;
+      for (auto i = _map.begin(); i != _map.end();)
+      {
+         if (i->second.expired())
+         {
+            i = _map.erase(i);
+            ++n;
+         }
+         else
+         {
+            ++i;
+         }
+      }
+      return n;
+   }
+
+   pixmap_cache& get_pixmap_cache()
+   {
+      static pixmap_cache cache;
+      return cache;
+   }
+}
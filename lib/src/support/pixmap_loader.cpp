@@ -0,0 +1,137 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/pixmap_loader.hpp>
+#include <elements/support/pixmap_cache.hpp>
+#include <asio.hpp>
+#include <algorithm>
+#include <thread>
+
+namespace cycfi::elements
+{
+   pixmap_load::pixmap_load(done_function done)
+    : _done{std::move(done)}
+   {}
+
+   void pixmap_load::cancel()
+   {
+      // Waits for a `complete` in progress
+      std::lock_guard<std::mutex> lock{_mutex};
+      _done = nullptr;
+   }
+
+   bool pixmap_load::is_cancelled() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      return !_done;
+   }
+
+   void pixmap_load::complete(pixmap_ptr pm)
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (_done)
+      {
+         auto done = std::move(_done);
+         _done = nullptr;
+         done(std::move(pm));
+      }
+   }
+
+   class pixmap_loader
+   {
+   public:
+
+      static pixmap_loader& get()
+      {
+         static pixmap_loader loader;
+         return loader;
+      }
+
+      void post(std::function<void()> f)
+      {
+         asio::post(_pool, std::move(f));
+      }
+
+      void load(pixmap_load_ptr load, fs::path path, float scale)
+      {
+         asio::post(_pool,
+            [load, path = std::move(path), scale]()
+            {
+               if (load->is_cancelled())
+                  return;
+
+               pixmap_ptr pm;
+               try
+               {
+                  pm = get_pixmap_cache().get(path, scale);
+               }
+               catch (failed_to_load_pixmap const&)
+               {
+               }
+               load->complete(std::move(pm));
+            }
+         );
+      }
+
+      void make(pixmap_load_ptr load, std::function<pixmap_ptr()> make)
+      {
+         asio::post(_pool,
+            [load, make = std::move(make)]()
+            {
+               if (load->is_cancelled())
+                  return;
+
+               pixmap_ptr pm;
+               try
+               {
+                  pm = make();
+               }
+               catch (failed_to_load_pixmap const&)
+               {
+               }
+               load->complete(std::move(pm));
+            }
+         );
+      }
+
+   private:
+
+      pixmap_loader()
+       : _pool{std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 1, 4)}
+      {
+         // Make sure the pixmap cache outlives the pool, which waits for
+         // the loads in progress when it is destroyed at exit.
+         get_pixmap_cache();
+      }
+
+      asio::thread_pool       _pool;
+   };
+
+   pixmap_load_ptr load_pixmap_async(
+      fs::path path
+    , float scale
+    , pixmap_load::done_function done
+   )
+   {
+      auto load = std::make_shared<pixmap_load>(std::move(done));
+      pixmap_loader::get().load(load, std::move(path), scale);
+      return load;
+   }
+
+   pixmap_load_ptr make_pixmap_async(
+      std::function<pixmap_ptr()> make
+    , pixmap_load::done_function done
+   )
+   {
+      auto load = std::make_shared<pixmap_load>(std::move(done));
+      pixmap_loader::get().make(load, std::move(make));
+      return load;
+   }
+
+   void post_decode_work(std::function<void()> f)
+   {
+      pixmap_loader::get().post(std::move(f));
+   }
+}
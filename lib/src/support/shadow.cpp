@@ -0,0 +1,197 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/shadow.hpp>
+#include <elements/support/detail/pixel_convert.hpp>
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace cycfi::elements
+{
+   namespace
+   {
+      // Colors are keyed at 8 bits per channel, the precision they are
+      // drawn with
+      std::uint32_t to_rgba(color c)
+      {
+         auto channel = [](float v)
+         {
+            return std::uint32_t(std::lround(std::clamp(v, 0.0f, 1.0f) * 255));
+         };
+         return (channel(c.red) << 24)
+            | (channel(c.green) << 16)
+            | (channel(c.blue) << 8)
+            | channel(c.alpha)
+            ;
+      }
+   }
+
+   bool shadow_cache::key::operator<(key const& rhs) const
+   {
+      return std::tie(width, height, radius, corner_radius, rgba, resolution)
+         < std::tie(rhs.width, rhs.height, rhs.radius, rhs.corner_radius, rhs.rgba, rhs.resolution);
+   }
+
+   // The Gaussian is all but zero past three standard deviations
+   float shadow_cache::margin(float radius)
+   {
+      return std::ceil(std::max(radius, 0.0f) * 1.5f);
+   }
+
+   /**
+    * \brief
+    *    Get the shadow of a `size` rectangle, rendering it if it is not in
+    *    the cache. `resolution` is the number of pixels per user unit.
+    */
+   pixmap_ptr shadow_cache::get(
+      extent size
+    , float radius
+    , float corner_radius
+    , color c
+    , float resolution
+   )
+   {
+      key k{size.x, size.y, radius, corner_radius, to_rgba(c), resolution};
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         if (auto i = _map.find(k); i != _map.end())
+         {
+            ++_hits;
+            _entries.splice(_entries.begin(), _entries, i->second);
+            return i->second->pixmap;
+         }
+         ++_misses;
+      }
+
+      // Render outside the lock. If another thread beat us to it, use theirs.
+      auto pm = render(k);
+
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (auto i = _map.find(k); i != _map.end())
+         return i->second->pixmap;
+
+      auto bytes = pm->bytes();
+      _entries.push_front({k, pm, bytes});
+      _map.emplace(k, _entries.begin());
+      _bytes += bytes;
+      trim();
+      return pm;
+   }
+
+   pixmap_ptr shadow_cache::render(key const& k)
+   {
+      auto m = margin(k.radius);
+      auto pw = std::max(std::ceil((k.width + (2 * m)) * k.resolution), 1.0f);
+      auto ph = std::max(std::ceil((k.height + (2 * m)) * k.resolution), 1.0f);
+      auto pm = std::make_shared<pixmap>(point{pw, ph}, 1 / k.resolution);
+
+      pixmap_context ctx{*pm};
+      {
+         canvas cnv{*ctx.context()};
+         cnv.fill_style(rgba(k.rgba));
+         rect r{m, m, m + k.width, m + k.height};
+         if (k.corner_radius > 0)
+            cnv.fill_round_rect(r, k.corner_radius);
+         else
+            cnv.fill_rect(r);
+      }
+
+      auto surface = cairo_get_target(ctx.context());
+      cairo_surface_flush(surface);
+      if (auto data = cairo_image_surface_get_data(surface))
+      {
+         detail::gaussian_blur(
+            data, cairo_image_surface_get_stride(surface)
+          , std::size_t(pw), std::size_t(ph)
+          , (k.radius / 2) * k.resolution
+         );
+      }
+      cairo_surface_mark_dirty(surface);
+      return pm;
+   }
+
+   // Drop the least recently used shadows, but never the newest one
+   void shadow_cache::trim()
+   {
+      while (_bytes > _budget && _entries.size() > 1)
+      {
+         auto& e = _entries.back();
+         _map.erase(e.k);
+         _bytes -= e.bytes;
+         _entries.pop_back();
+      }
+   }
+
+   std::size_t shadow_cache::budget() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      return _budget;
+   }
+
+   void shadow_cache::budget(std::size_t bytes)
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _budget = bytes;
+      trim();
+   }
+
+   shadow_cache::statistics shadow_cache::stats() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      statistics r;
+      r.hits = _hits;
+      r.misses = _misses;
+      r.entries = _entries.size();
+      r.bytes = _bytes;
+      return r;
+   }
+
+   void shadow_cache::reset_stats()
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _hits = _misses = 0;
+   }
+
+   shadow_cache& get_shadow_cache()
+   {
+      static shadow_cache cache;
+      return cache;
+   }
+
+   void draw_shadow(
+      canvas& cnv
+    , rect bounds
+    , float radius
+    , float corner_radius
+    , color c
+    , point offset
+   )
+   {
+      bounds = bounds.move(offset.x, offset.y);
+      if (bounds.is_empty() || c.alpha <= 0)
+         return;
+
+      if (radius <= 0)
+      {
+         auto save = cnv.new_state();
+         cnv.fill_style(c);
+         cnv.fill_round_rect(bounds, corner_radius);
+         return;
+      }
+
+      // Render at the target's resolution, HiDPI scale included, in quarter
+      // steps so that a zoom in progress does not fill the cache
+      auto ratio = cnv.pixel_ratio();
+      auto resolution = std::clamp(std::round(ratio * 4) / 4, 0.25f, 8.0f);
+
+      auto pm = get_shadow_cache().get(bounds.size(), radius, corner_radius, c, resolution);
+      auto m = shadow_cache::margin(radius);
+      auto size_ = pm->size();
+      auto left = bounds.left - m;
+      auto top = bounds.top - m;
+      cnv.draw(*pm, rect{left, top, left + size_.x, top + size_.y});
+   }
+}
@@ -0,0 +1,162 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/shaped_text_cache.hpp>
+#include <functional>
+
+namespace cycfi::elements
+{
+   // Each entry holds a reference to its scaled font, so the font pointer
+   // in the key can't be reused by another font while the entry is alive.
+   struct shaped_text_cache::entry
+   {
+      cairo_scaled_font_t*    font;
+      std::string             utf8;
+      shaped_text_ptr         shaped;
+      std::size_t             bytes;
+   };
+
+   bool shaped_text_cache::key::operator==(key const& rhs) const
+   {
+      return font == rhs.font && utf8 == rhs.utf8;
+   }
+
+   std::size_t shaped_text_cache::key_hash::operator()(key const& k) const
+   {
+      auto h = std::hash<string_view>{}(k.utf8);
+      return h ^ (std::hash<void*>{}(k.font) + 0x9e3779b9 + (h << 6) + (h >> 2));
+   }
+
+   double shaped_text_cache::statistics::hit_rate() const
+   {
+      auto total = hits + misses;
+      return total? double(hits) / total : 0;
+   }
+
+   shaped_text_cache::shaped_text_cache(std::size_t budget)
+    : _budget{budget}
+   {}
+
+   shaped_text_cache::~shaped_text_cache()
+   {
+      clear();
+   }
+
+   namespace
+   {
+      shaped_text_ptr shape(cairo_scaled_font_t* font, string_view utf8)
+      {
+         auto result = std::make_shared<shaped_text>();
+         result->extents = {};
+
+         cairo_glyph_t* glyphs = nullptr;
+         int num_glyphs = 0;
+         auto stat = cairo_scaled_font_text_to_glyphs(
+            font, 0, 0, utf8.data(), int(utf8.size())
+          , &glyphs, &num_glyphs, nullptr, nullptr, nullptr
+         );
+
+         if (stat == CAIRO_STATUS_SUCCESS)
+         {
+            result->glyphs.assign(glyphs, glyphs + num_glyphs);
+            cairo_scaled_font_glyph_extents(font, glyphs, num_glyphs, &result->extents);
+         }
+         if (glyphs)
+            cairo_glyph_free(glyphs);
+         return result;
+      }
+   }
+
+   /**
+    * \brief
+    *    Get the shaped text for `utf8` with the given scaled font, shaping
+    *    and caching it if it's not in the cache yet.
+    */
+   shaped_text_ptr shaped_text_cache::get(cairo_scaled_font_t* font, string_view utf8)
+   {
+      {
+         std::lock_guard<std::mutex> lock{_mutex};
+         auto i = _map.find(key{font, utf8});
+         if (i != _map.end())
+         {
+            ++_hits;
+            _entries.splice(_entries.begin(), _entries, i->second);
+            return i->second->shaped;
+         }
+         ++_misses;
+      }
+
+      // Shape outside the lock; cairo's scaled fonts are thread safe.
+      auto shaped = shape(font, utf8);
+      auto bytes = sizeof(entry) + sizeof(shaped_text) + utf8.size()
+         + (shaped->glyphs.size() * sizeof(cairo_glyph_t));
+
+      std::lock_guard<std::mutex> lock{_mutex};
+      if (_map.find(key{font, utf8}) == _map.end())
+      {
+         _entries.push_front(
+            entry{cairo_scaled_font_reference(font), std::string{utf8}, shaped, bytes}
+         );
+         auto& e = _entries.front();
+         _map.emplace(key{e.font, e.utf8}, _entries.begin());
+         _bytes += bytes;
+         trim();
+      }
+      return shaped;
+   }
+
+   void shaped_text_cache::drop_last()
+   {
+      auto& e = _entries.back();
+      _map.erase(key{e.font, e.utf8});
+      _bytes -= e.bytes;
+      cairo_scaled_font_destroy(e.font);
+      _entries.pop_back();
+   }
+
+   void shaped_text_cache::trim()
+   {
+      while (_bytes > _budget && !_entries.empty())
+         drop_last();
+   }
+
+   std::size_t shaped_text_cache::budget() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      return _budget;
+   }
+
+   void shaped_text_cache::budget(std::size_t bytes)
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _budget = bytes;
+      trim();
+   }
+
+   shaped_text_cache::statistics shaped_text_cache::stats() const
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      return {_hits, _misses, _entries.size(), _bytes, _budget};
+   }
+
+   void shaped_text_cache::reset_stats()
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _hits = _misses = 0;
+   }
+
+   void shaped_text_cache::clear()
+   {
+      std::lock_guard<std::mutex> lock{_mutex};
+      while (!_entries.empty())
+         drop_last();
+   }
+
+   shaped_text_cache& get_shaped_text_cache()
+   {
+      static shaped_text_cache cache;
+      return cache;
+   }
+}
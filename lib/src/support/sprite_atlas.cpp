@@ -0,0 +1,227 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/sprite_atlas.hpp>
+#include <elements/support/resource_paths.hpp>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <system_error>
+
+namespace cycfi::elements
+{
+   sprite_atlas::sprite_atlas(float scale, int page_size, int padding, int mip_levels)
+    : _scale{scale}
+    , _page_size{page_size}
+    , _padding{padding}
+    , _align{1 << std::clamp(mip_levels, 0, 8)}
+   {}
+
+   /**
+    * \brief
+    *    Add the image at `path`, unless it is already in the atlas. Returns
+    *    the index of its region, valid once packed.
+    */
+   std::size_t sprite_atlas::add(fs::path const& path)
+   {
+      auto full_path = find_file(path);
+      std::error_code ec;
+      if (auto canonical = fs::weakly_canonical(full_path, ec); !ec && !full_path.empty())
+         full_path = canonical;
+
+      auto key = full_path.empty()? path.generic_string() : full_path.generic_string();
+      if (auto i = _paths.find(key); i != _paths.end())
+         return i->second;
+
+      auto i = add(std::make_shared<pixmap>(path, _scale));
+      _paths.emplace(key, i);
+      return i;
+   }
+
+   /**
+    * \brief
+    *    Add a pixmap. Returns the index of its region, valid once packed.
+    */
+   std::size_t sprite_atlas::add(pixmap_ptr pm)
+   {
+      auto size_ = pm->size();
+      auto pm_scale = pm->scale();
+      auto w = int(std::lround(size_.x / pm_scale));
+      auto h = int(std::lround(size_.y / pm_scale));
+
+      auto index = _regions.size();
+      _regions.push_back({});
+      _pending.push_back({index, std::move(pm), w, h});
+      return index;
+   }
+
+   sprite_region const* sprite_atlas::find(fs::path const& path) const
+   {
+      auto full_path = find_file(path);
+      std::error_code ec;
+      if (auto canonical = fs::weakly_canonical(full_path, ec); !ec && !full_path.empty())
+         full_path = canonical;
+
+      auto key = full_path.empty()? path.generic_string() : full_path.generic_string();
+      if (auto i = _paths.find(key); i != _paths.end() && _regions[i->second].pixmap)
+         return &_regions[i->second];
+      return nullptr;
+   }
+
+   /**
+    * \brief
+    *    Pack the sprites added since the last call, and copy them into
+    *    their pages.
+    */
+   void sprite_atlas::pack()
+   {
+      // Tallest first packs best with a skyline
+      std::stable_sort(_pending.begin(), _pending.end(),
+         [](pending const& a, pending const& b)
+         {
+            return a.height != b.height? a.height > b.height : a.width > b.width;
+         }
+      );
+
+      // Every cell is a multiple of _align, so the skyline keeps all the
+      // origins aligned. The gap is at least one pixel of the deepest mip
+      // level, so bilinear filtering there stays inside the sprite's cell.
+      auto gap = std::max(_padding, _align);
+      auto align_up = [this](int n) { return (n + _align - 1) & -_align; };
+
+      for (auto& s : _pending)
+      {
+         auto w = align_up(s.width + gap);
+         auto h = align_up(s.height + gap);
+         int x = 0, y = 0;
+
+         page* p = nullptr;
+         for (auto& pg : _pages)
+         {
+            if (place(pg, w, h, x, y))
+            {
+               p = &pg;
+               break;
+            }
+         }
+         if (!p)
+         {
+            p = &new_page(std::max(_page_size, w), std::max(_page_size, h));
+            place(*p, w, h, x, y);
+         }
+
+         rect bounds{
+            x * _scale, y * _scale
+          , (x + s.width) * _scale, (y + s.height) * _scale
+         };
+         pixmap_context{*p->pixmap}.copy(*s.pixmap, bounds.top_left());
+         _regions[s.index] = {p->pixmap, bounds};
+         _used += std::size_t(s.width) * s.height;
+      }
+      _pending.clear();
+   }
+
+   sprite_atlas::page& sprite_atlas::new_page(int w, int h)
+   {
+      page p;
+      p.pixmap = std::make_shared<pixmap>(point{float(w), float(h)}, _scale);
+      p.width = w;
+      p.height = h;
+      p.skyline.push_back({0, 0, w});
+      _pages.push_back(std::move(p));
+      return _pages.back();
+   }
+
+   /**
+    * \brief
+    *    Find a place for a `w` x `h` rectangle on page `p`, using the
+    *    bottom-left skyline heuristic: the lowest position, and of those,
+    *    the one on the narrowest skyline segment. Updates the skyline and
+    *    returns true if it fits.
+    */
+   bool sprite_atlas::place(page& p, int w, int h, int& x, int& y)
+   {
+      auto& sky = p.skyline;
+      std::size_t best = sky.size();
+      int best_y = INT_MAX;
+      int best_width = INT_MAX;
+
+      for (std::size_t i = 0; i != sky.size(); ++i)
+      {
+         if (sky[i].x + w > p.width)
+            break;
+
+         // The rectangle rests on the highest segment under it
+         int top = 0;
+         int remaining = w;
+         for (auto j = i; remaining > 0; ++j)
+         {
+            top = std::max(top, sky[j].y);
+            remaining -= sky[j].width;
+         }
+         if (top + h > p.height)
+            continue;
+
+         if (top < best_y || (top == best_y && sky[i].width < best_width))
+         {
+            best = i;
+            best_y = top;
+            best_width = sky[i].width;
+         }
+      }
+
+      if (best == sky.size())
+         return false;
+
+      x = sky[best].x;
+      y = best_y;
+
+      // Raise the skyline under the rectangle, trimming or removing the
+      // segments it covers
+      sky.insert(sky.begin() + best, skyline_node{x, y + h, w});
+      for (auto i = best + 1; i < sky.size();)
+      {
+         auto right = sky[i-1].x + sky[i-1].width;
+         if (sky[i].x >= right)
+            break;
+         auto overlap = right - sky[i].x;
+         sky[i].x += overlap;
+         sky[i].width -= overlap;
+         if (sky[i].width > 0)
+            break;
+         sky.erase(sky.begin() + i);
+      }
+
+      // Merge neighbors at the same height
+      for (std::size_t i = 0; i + 1 < sky.size();)
+      {
+         if (sky[i].y == sky[i+1].y)
+         {
+            sky[i].width += sky[i+1].width;
+            sky.erase(sky.begin() + i + 1);
+         }
+         else
+         {
+            ++i;
+         }
+      }
+      return true;
+   }
+
+   sprite_atlas::statistics sprite_atlas::stats() const
+   {
+      statistics r;
+      r.sprites = _regions.size();
+      r.pages = _pages.size();
+      std::size_t area = 0;
+      for (auto const& p : _pages)
+      {
+         r.bytes += p.pixmap->bytes();
+         area += std::size_t(p.width) * p.height;
+      }
+      r.efficiency = area? double(_used) / area : 0;
+      return r;
+   }
+}
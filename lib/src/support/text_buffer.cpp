@@ -0,0 +1,227 @@
+/*=============================================================================
+   Copyright (c) 2016-2024 Joel de Guzman
+
+   Distributed under the MIT License [ https://opensource.org/licenses/MIT ]
+=============================================================================*/
+#include <elements/support/text_buffer.hpp>
+#include <cstring>
+#include <random>
+
+namespace cycfi::elements
+{
+   namespace
+   {
+      // The minimum capacity of the buffers holding inserted text
+      constexpr std::size_t min_chunk_size = 64 * 1024;
+
+      std::uint32_t random_priority()
+      {
+         thread_local std::minstd_rand gen{std::random_device{}()};
+         return std::uint32_t(gen());
+      }
+   }
+
+   text_buffer::text_buffer(string_view text)
+   {
+      if (!text.empty())
+      {
+         auto buf = std::make_shared<chunk>(text.size());
+         std::memcpy(buf->bytes.get(), text.data(), text.size());
+         buf->used = text.size();
+         _root = make_leaf({buf, 0, text.size()});
+      }
+   }
+
+   // Copies share the tree, but not the append buffer. Otherwise, appending
+   // to one would clobber what the other appended.
+   text_buffer::text_buffer(text_buffer const& rhs)
+    : _root{rhs._root}
+   {}
+
+   text_buffer& text_buffer::operator=(text_buffer const& rhs)
+   {
+      if (this != &rhs)
+      {
+         _root = rhs._root;
+         _add.reset();
+      }
+      return *this;
+   }
+
+   text_buffer::node_ptr
+   text_buffer::make_node(node_ptr left, piece const& p, node_ptr right, std::uint32_t priority)
+   {
+      auto size = size_of(left) + p.length + size_of(right);
+      return std::make_shared<node const>(
+         node{std::move(left), std::move(right), p, size, priority}
+      );
+   }
+
+   text_buffer::node_ptr text_buffer::make_leaf(piece const& p)
+   {
+      return make_node(nullptr, p, nullptr, random_priority());
+   }
+
+   text_buffer::node_ptr text_buffer::merge(node_ptr const& a, node_ptr const& b)
+   {
+      if (!a)
+         return b;
+      if (!b)
+         return a;
+      if (a->priority > b->priority)
+         return make_node(a->left, a->p, merge(a->right, b), a->priority);
+      return make_node(merge(a, b->left), b->p, b->right, b->priority);
+   }
+
+   /**
+    * \brief
+    *    Split the tree into the first `pos` bytes and the rest. A piece that
+    *    straddles `pos` is split in two.
+    */
+   text_buffer::node_pair text_buffer::split(node_ptr const& n, std::size_t pos)
+   {
+      if (!n)
+         return {};
+
+      auto left_size = size_of(n->left);
+      if (pos <= left_size)
+      {
+         auto [a, b] = split(n->left, pos);
+         return {a, make_node(b, n->p, n->right, n->priority)};
+      }
+
+      pos -= left_size;
+      if (pos >= n->p.length)
+      {
+         auto [a, b] = split(n->right, pos - n->p.length);
+         return {make_node(n->left, n->p, a, n->priority), b};
+      }
+
+      piece head = {n->p.buffer, n->p.offset, pos};
+      piece tail = {n->p.buffer, n->p.offset + pos, n->p.length - pos};
+      return {
+         make_node(n->left, head, nullptr, n->priority)
+       , merge(make_leaf(tail), n->right)
+      };
+   }
+
+   text_buffer::piece const* text_buffer::last_piece(node_ptr const& n)
+   {
+      if (!n)
+         return nullptr;
+      auto const* i = n.get();
+      while (i->right)
+         i = i->right.get();
+      return &i->p;
+   }
+
+   // Grow the last piece of the tree by `length` bytes
+   text_buffer::node_ptr text_buffer::extend_last(node_ptr const& n, std::size_t length)
+   {
+      if (n->right)
+         return make_node(n->left, n->p, extend_last(n->right, length), n->priority);
+      piece p = n->p;
+      p.length += length;
+      return make_node(n->left, p, nullptr, n->priority);
+   }
+
+   char text_buffer::operator[](std::size_t pos) const
+   {
+      auto const* n = _root.get();
+      while (n)
+      {
+         auto left_size = size_of(n->left);
+         if (pos < left_size)
+         {
+            n = n->left.get();
+         }
+         else if (pos < left_size + n->p.length)
+         {
+            return n->p.view()[pos - left_size];
+         }
+         else
+         {
+            pos -= left_size + n->p.length;
+            n = n->right.get();
+         }
+      }
+      return 0;
+   }
+
+   void text_buffer::insert(std::size_t pos, string_view text)
+   {
+      if (text.empty())
+         return;
+      pos = std::min(pos, size());
+
+      // Append the text to our own buffer
+      if (!_add || _add->capacity - _add->used < text.size())
+         _add = std::make_shared<chunk>(std::max(min_chunk_size, text.size()));
+      auto offset = _add->used;
+      std::memcpy(_add->bytes.get() + offset, text.data(), text.size());
+      _add->used += text.size();
+
+      auto [left, right] = split(_root, pos);
+
+      // If the piece before `pos` ends right where we appended, we can
+      // simply extend it. This is the common case when typing.
+      auto const* last = last_piece(left);
+      if (last && last->buffer == _add && last->offset + last->length == offset)
+         left = extend_last(left, text.size());
+      else
+         left = merge(left, make_leaf({_add, offset, text.size()}));
+
+      _root = merge(left, right);
+   }
+
+   void text_buffer::erase(std::size_t pos, std::size_t count)
+   {
+      pos = std::min(pos, size());
+      count = std::min(count, size() - pos);
+      if (count == 0)
+         return;
+
+      auto [left, rest] = split(_root, pos);
+      auto [mid, right] = split(rest, count);
+      _root = merge(left, right);
+   }
+
+   void text_buffer::replace(std::size_t pos, std::size_t count, string_view text)
+   {
+      erase(pos, count);
+      insert(pos, text);
+   }
+
+   void text_buffer::clear()
+   {
+      _root.reset();
+      _add.reset();
+   }
+
+   std::string text_buffer::substr(std::size_t pos, std::size_t count) const
+   {
+      std::string result;
+      for_each_piece(pos, count,
+         [&](string_view s)
+         {
+            result.append(s.data(), s.size());
+            return true;
+         }
+      );
+      return result;
+   }
+
+   std::string text_buffer::str() const
+   {
+      std::string result;
+      result.reserve(size());
+      for_each_piece(
+         [&](string_view s)
+         {
+            result.append(s.data(), s.size());
+            return true;
+         }
+      );
+      return result;
+   }
+}
@@ -46,7 +46,7 @@ namespace cycfi::elements
    {
       auto  state = cnv.new_state();
       cnv.font(descr);
-      auto  info = cnv.measure_text(std::string(text).c_str());
+      auto  info = cnv.measure_text(text);
       auto  height = info.ascent + info.descent + info.leading;
       return {info.size.x, height};
    }
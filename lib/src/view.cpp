@@ -300,12 +300,24 @@
 
    void view::add_undo(undo_redo_task f)
    {
-      _undo_stack.push(f);
+      _undo_size += f.size;
+      _undo_stack.push_back(std::move(f));
       if (has_redo())
       {
          // clear the redo stack
-         undo_stack_type empty{};
-         _redo_stack.swap(empty);
+         for (auto const& t : _redo_stack)
+            _undo_size -= t.size;
+         _redo_stack.clear();
+      }
+      trim_undo();
+   }
+
+   void view::trim_undo()
+   {
+      while (_undo_size > _undo_budget && _undo_stack.size() > 1)
+      {
+         _undo_size -= _undo_stack.front().size;
+         _undo_stack.pop_front();
       }
    }
 
@@ -313,9 +325,9 @@
    {
       if (has_undo())
       {
-         auto t = _undo_stack.top();
-         _undo_stack.pop();
-         _redo_stack.push(t);
+         auto t = _undo_stack.back();
+         _undo_stack.pop_back();
+         _redo_stack.push_back(t);
          t.undo();  // execute undo function
          return true;
       }
@@ -326,9 +338,9 @@
    {
       if (has_redo())
       {
-         auto t = _redo_stack.top();
-         _undo_stack.push(t);
-         _redo_stack.pop();
+         auto t = _redo_stack.back();
+         _undo_stack.push_back(t);
+         _redo_stack.pop_back();
          t.redo();  // execute redo function
          return true;
       }